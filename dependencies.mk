@@ -2,4 +2,5 @@ mediatester.o: mediatester.c \
  fragments/include/r4g/r4g_u0ywydbuiziuzssqsi5l0mdid.h \
  fragments/include/dim_sdbrke8ae851uitgzm4nv3ea2.h \
  fragments/include/getopt_nh7lll77vb62ycgwzwf30zlln.h \
- fragments/include/pearson.h fragments/include/linux/ioprio.h
+ fragments/include/pearson.h fragments/include/pattern.h \
+ fragments/include/xxh64.h fragments/include/linux/ioprio.h
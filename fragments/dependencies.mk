@@ -11,8 +11,10 @@ getopt_simplest_perror_missing_arg.o: \
  include/getopt_nh7lll77vb62ycgwzwf30zlln.h
 getopt_simplest_perror_opt.o: getopt_simplest_perror_opt.c \
  include/getopt_nh7lll77vb62ycgwzwf30zlln.h
+pattern.o: pattern.c include/pattern.h
 pearnd.o: pearnd.c include/pearson.h \
  include/dim_sdbrke8ae851uitgzm4nv3ea2.h
 release_c1.o: release_c1.c include/r4g/r4g_u0ywydbuiziuzssqsi5l0mdid.h
 release_to_c1.o: release_to_c1.c \
  include/r4g/r4g_u0ywydbuiziuzssqsi5l0mdid.h
+xxh64.o: xxh64.c include/xxh64.h
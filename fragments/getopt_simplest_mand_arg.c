@@ -11,10 +11,11 @@ char const *getopt_simplest_mand_arg(
    if (i == 0 || optind == argc) return 0;
    if (argv[optind][i]) {
       arg= argv[optind++] + i;
-      i= 0;
    } else {
+      if (++optind == argc) return 0;
       arg= argv[optind++];
    }
+   i= 0;
    *optind_ref= optind;
    *optpos_ref= i;
    return arg;
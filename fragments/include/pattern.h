@@ -0,0 +1,32 @@
+#ifndef HEADER_8XU8EHT755PQ54O95WY5TZFV9_INCLUDED
+#define HEADER_8XU8EHT755PQ54O95WY5TZFV9_INCLUDED
+
+/* Deterministic test patterns as an alternative to the PRNG stream of
+ * pearson.h, for classic tests like those of badblocks.
+ *
+ * Every pattern repeats with a period of 8 bytes: Byte <pos> of the stream
+ * is byte pos % 8 of a little endian 64 bit word. This word is either
+ * <fill> for all positions, or the offset pos - pos % 8 itself for address
+ * stamps. Byte 0x55, walking ones etc. are just different <fill> values.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+   uint_fast64_t fill;
+   int stamps; /* Use the offset of each word instead of <fill>. */
+} pattern;
+
+/* Fill buffer with the <count> bytes of pattern <p> starting at stream
+ * offset <pos>. */
+void pattern_generate(
+   void *dst, size_t count, uint_fast64_t pos, pattern const *p
+);
+
+/* XOR buffer with the <count> bytes of pattern <p> starting at stream
+ * offset <pos>. Returns nonzero if any of the XOR operations resulted in a
+ * non-zero value. */
+int pattern_xor(void *dst, size_t count, uint_fast64_t pos, pattern const *p);
+
+#endif /* !HEADER_8XU8EHT755PQ54O95WY5TZFV9_INCLUDED */
@@ -38,4 +38,17 @@ void pearnd_generate(void *dst, size_t count, pearnd_offset *po);
  * non-zero value. */
 int pearnd_xor(void *dst, size_t count, pearnd_offset *po);
 
+/* Compare buffer with the next <count> PRNG bytes, starting at the current
+ * stream position, without storing them anywhere but in a small local
+ * buffer. Returns the index of the first differing byte, or <count> if all
+ * bytes are the same. The stream position advances by the returned number
+ * of bytes, i. e. up to the differing byte. */
+size_t pearnd_compare(void const *src, size_t count, pearnd_offset *po);
+
+/* Like pearnd_generate(), but writes <dst> with non-temporal stores which
+ * bypass the CPU caches where the platform supports this. For output which
+ * the CPU will not read again. The stores are fenced before returning, so
+ * the usual synchronization suffices for handing <dst> to other threads. */
+void pearnd_generate_nt(void *dst, size_t count, pearnd_offset *po);
+
 #endif /* !HEADER_ESM240BGRPZJZAJ61R9RMUV23_INCLUDED */
@@ -0,0 +1,14 @@
+#ifndef HEADER_K3W7ZQ2M9RXHB5T1VJ8NC4YDP_INCLUDED
+#define HEADER_K3W7ZQ2M9RXHB5T1VJ8NC4YDP_INCLUDED
+
+/* The XXH64 non-cryptographic hash function by Yann Collet. Very fast, and
+ * good enough for detecting accidental corruption of data. The results are
+ * the same on all platforms. */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Returns the XXH64 hash of <count> bytes at <data> using <seed>. */
+uint_fast64_t xxh64(void const *data, size_t count, uint_fast64_t seed);
+
+#endif /* !HEADER_K3W7ZQ2M9RXHB5T1VJ8NC4YDP_INCLUDED */
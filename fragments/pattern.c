@@ -0,0 +1,91 @@
+#include <pattern.h>
+#include <string.h>
+
+/* Size of the first part of the buffer which is filled word by word. The
+ * rest is copied from there, which runs at memcpy() speed. */
+#define TEMPLATE_SIZE 256
+
+/* Returns the little endian word of pattern <p> for the 8 bytes starting
+ * at stream offset <pos>, which must be a multiple of 8. */
+static uint64_t word_at(pattern const *p, uint_fast64_t pos) {
+   return p->stamps ? (uint64_t)pos : (uint64_t)p->fill;
+}
+
+static uint8_t byte_at(pattern const *p, uint_fast64_t pos) {
+   return (uint8_t)(word_at(p, pos - pos % 8) >> 8 * (unsigned)(pos % 8));
+}
+
+/* Returns the native representation of little endian word <v>, so that
+ * memcpy() of it yields the right byte order on any platform. */
+static uint64_t native(uint64_t v) {
+   uint8_t b[8];
+   uint64_t w;
+   unsigned i;
+   for (i= 0; i < 8; ++i) b[i]= (uint8_t)(v >> 8 * i);
+   memcpy(&w, b, sizeof w);
+   return w;
+}
+
+/* Returns whether all bytes of the pattern are the same, and sets *<byte>
+ * to it then. */
+static int constant(pattern const *p, uint8_t *byte) {
+   *byte= (uint8_t)p->fill;
+   return !p->stamps && p->fill == *byte * UINT64_C(0x0101010101010101);
+}
+
+void pattern_generate(
+   void *dst, size_t count, uint_fast64_t pos, pattern const *p
+) {
+   uint8_t *out= dst;
+   uint8_t byte;
+   if (constant(p, &byte)) {
+      memset(out, byte, count);
+      return;
+   }
+   /* Bytes up to the next word boundary of the stream. */
+   for (; count && pos % 8; --count) *out++= byte_at(p, pos++);
+   if (p->stamps) {
+      for (; count >= 8; count-= 8, out+= 8, pos+= 8) {
+         uint64_t const w= native(word_at(p, pos));
+         memcpy(out, &w, sizeof w);
+      }
+   } else if (count >= 8) {
+      uint64_t const w= native(word_at(p, pos));
+      size_t n= TEMPLATE_SIZE, done;
+      if (count < n) n= count - count % 8;
+      for (done= 0; done < n; done+= 8) memcpy(out + done, &w, sizeof w);
+      /* The pattern has a period of 8 bytes and the template starts at a
+       * word boundary, so the rest is just a repetition of it. */
+      for (; count - done >= n; done+= n) memcpy(out + done, out, n);
+      memcpy(out + done, out, count - done);
+      return;
+   }
+   for (; count; --count) *out++= byte_at(p, pos++);
+}
+
+int pattern_xor(void *dst, size_t count, uint_fast64_t pos, pattern const *p) {
+   uint8_t *out= dst;
+   uint64_t nonzero= 0;
+   for (; count && pos % 8; --count) nonzero|= *out++^= byte_at(p, pos++);
+   if (p->stamps) {
+      for (; count >= 8; count-= 8, out+= 8, pos+= 8) {
+         uint64_t v;
+         memcpy(&v, out, sizeof v);
+         nonzero|= v^= native(word_at(p, pos));
+         memcpy(out, &v, sizeof v);
+      }
+   } else {
+      uint64_t const w= native(word_at(p, pos));
+      size_t const words= count / 8;
+      size_t i;
+      for (i= 0; i < words; ++i) {
+         uint64_t v;
+         memcpy(&v, out + 8 * i, sizeof v);
+         nonzero|= v^= w;
+         memcpy(out + 8 * i, &v, sizeof v);
+      }
+      count-= 8 * words; out+= 8 * words; pos+= 8 * words;
+   }
+   for (; count; --count) nonzero|= *out++^= byte_at(p, pos++);
+   return nonzero != 0;
+}
@@ -3,6 +3,10 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <string.h>
+#ifdef __SSE2__
+   #include <emmintrin.h>
+#endif
 
 #define SWAP(type, v1, v2) { type t= (v1); (v1)= (v2); (v2)= t; }
 
@@ -49,32 +53,175 @@ void pearnd_seek(pearnd_offset *po, uint_fast64_t pos) {
    po->limbs= i;
 }
 
-#define PEAR_DO(output_stmt) \
+/* The hash of a position with <limbs> limbs, of which only the least
+ * significant one <b> varies within a block of 256 positions. <hi> holds
+ * the other limbs, which are constant for the whole block. */
+#define PEAR_H1(b) sbox[b]
+#define PEAR_H2(b) sbox[PEAR_H1(b) ^ (unsigned)(hi & 0xff)]
+#define PEAR_H3(b) sbox[PEAR_H2(b) ^ (unsigned)(hi >> 8 & 0xff)]
+#define PEAR_H4(b) sbox[PEAR_H3(b) ^ (unsigned)(hi >> 16 & 0xff)]
+#define PEAR_H5(b) sbox[PEAR_H4(b) ^ (unsigned)(hi >> 24 & 0xff)]
+#define PEAR_H6(b) sbox[PEAR_H5(b) ^ (unsigned)(hi >> 32 & 0xff)]
+#define PEAR_H7(b) sbox[PEAR_H6(b) ^ (unsigned)(hi >> 40 & 0xff)]
+#define PEAR_H8(b) sbox[PEAR_H7(b) ^ (unsigned)(hi >> 48 & 0xff)]
+
+/* Defines the kernels for positions with <limbs> limbs. They process the
+ * least significant limb values <b> up to (excluding) <stop> within the
+ * same block, four independent hashes at a time. */
+#define PEAR_KERNELS(limbs) \
+   static void generate_##limbs( \
+      uint8_t *out, unsigned b, unsigned stop, uint_fast64_t hi \
+   ) { \
+      (void)hi; \
+      for (; stop - b >= 4; b+= 4, out+= 4) { \
+         out[0]= PEAR_H##limbs(b); out[1]= PEAR_H##limbs(b + 1); \
+         out[2]= PEAR_H##limbs(b + 2); out[3]= PEAR_H##limbs(b + 3); \
+      } \
+      for (; b != stop; ++b) *out++= PEAR_H##limbs(b); \
+   } \
+   \
+   static unsigned xor_##limbs( \
+      uint8_t *out, unsigned b, unsigned stop, uint_fast64_t hi \
+   ) { \
+      unsigned not_all_same= 0; \
+      (void)hi; \
+      for (; stop - b >= 4; b+= 4, out+= 4) { \
+         not_all_same|= out[0]^= PEAR_H##limbs(b); \
+         not_all_same|= out[1]^= PEAR_H##limbs(b + 1); \
+         not_all_same|= out[2]^= PEAR_H##limbs(b + 2); \
+         not_all_same|= out[3]^= PEAR_H##limbs(b + 3); \
+      } \
+      for (; b != stop; ++b) not_all_same|= *out++^= PEAR_H##limbs(b); \
+      return not_all_same; \
+   }
+
+PEAR_KERNELS(1)
+PEAR_KERNELS(2)
+PEAR_KERNELS(3)
+PEAR_KERNELS(4)
+PEAR_KERNELS(5)
+PEAR_KERNELS(6)
+PEAR_KERNELS(7)
+PEAR_KERNELS(8)
+
+typedef void generator(uint8_t *, unsigned, unsigned, uint_fast64_t);
+typedef unsigned xorer(uint8_t *, unsigned, unsigned, uint_fast64_t);
+
+static generator *const generators[]= {
+   &generate_1, &generate_2, &generate_3, &generate_4
+,  &generate_5, &generate_6, &generate_7, &generate_8
+};
+
+static xorer *const xorers[]= {
+   &xor_1, &xor_2, &xor_3, &xor_4, &xor_5, &xor_6, &xor_7, &xor_8
+};
+
+/* Returns all limbs except the least significant one as a number. */
+static uint_fast64_t high_limbs(pearnd_offset const *po) {
+   uint_fast64_t hi= 0;
+   unsigned i;
+   for (i= po->limbs; --i; ) hi= hi << 8 | po->pos[i];
+   return hi;
+}
+
+/* Advances <po> by <n> positions within the current block. If this
+ * completes the block, propagates the carry and adds another limb when
+ * required. Returns whether the higher limbs have changed. */
+static int advance(pearnd_offset *po, unsigned n) {
+   unsigned i;
+   if (po->pos[0] + n < 1u << 8) {
+      po->pos[0]= (uint8_t)(po->pos[0] + n);
+      return 0;
+   }
+   for (i= 0; po->pos[i]= 0, ++i != po->limbs; ) {
+      if (++po->pos[i]) return 1;
+   }
+   assert(i < DIM(po->pos));
+   po->pos[i]= 1;
+   po->limbs= i + 1;
+   return 1;
+}
+
+/* Processes the PRNG stream block by block. The kernel is selected again
+ * only when the number of limbs changes. */
+#define PEAR_DO(kernels, result) \
    uint8_t *out= dst; \
-   uint8_t const *out_stop= (uint8_t const *)((char *)dst + count); \
-   uint8_t *pos= po->pos, mac; \
-   unsigned i, limbs= po->limbs, sum; \
-   assert(limbs >= 1); \
-   while (out != out_stop) { \
-      i= 0; mac= UINT8_C(0); \
-      do mac= sbox[mac ^ pos[i]]; while (++i != limbs); \
-      output_stmt; \
-      for (i= 0; pos[i]= (uint8_t)(sum= pos[i] + 1u) , sum == 1u << 8; ) { \
-         pos[i]= 0; \
-         if (++i == limbs) { \
-            pos[i]= 0; \
-            po->limbs= limbs= i + 1; \
-         } \
-         assert(i < DIM(po->pos)); \
+   uint_fast64_t hi= high_limbs(po); \
+   assert(po->limbs >= 1 && po->limbs <= DIM(kernels)); \
+   kernel= kernels[po->limbs - 1]; \
+   while (count) { \
+      unsigned const b= po->pos[0]; \
+      unsigned n= (1u << 8) - b; \
+      if (n > count) n= (unsigned)count; \
+      result (*kernel)(out, b, b + n, hi); \
+      out+= n; count-= n; \
+      if (advance(po, n)) { \
+         hi= high_limbs(po); \
+         assert(po->limbs <= DIM(kernels)); \
+         kernel= kernels[po->limbs - 1]; \
       } \
    }
 
 void pearnd_generate(void *dst, size_t count, pearnd_offset *po) {
-   PEAR_DO(*out++= mac);
+   generator *kernel;
+   PEAR_DO(generators, /* Nothing to combine. */);
 }
 
 int pearnd_xor(void *dst, size_t count, pearnd_offset *po) {
-   uint8_t not_all_same= 0;
-   PEAR_DO(not_all_same|= *out++^= mac);
-   return not_all_same;
+   xorer *kernel;
+   unsigned not_all_same= 0;
+   PEAR_DO(xorers, not_all_same|=);
+   return not_all_same != 0;
+}
+
+size_t pearnd_compare(void const *src, size_t count, pearnd_offset *po) {
+   /* Generate the expected data piece by piece into a buffer which stays
+    * in the L1 cache, and let memcmp() compare it word-wise. */
+   uint8_t expected[1 << 12];
+   uint8_t const *in= src;
+   size_t done= 0;
+   while (done < count) {
+      pearnd_offset const piece= *po;
+      size_t n= count - done;
+      if (n > sizeof expected) n= sizeof expected;
+      pearnd_generate(expected, n, po);
+      if (memcmp(in + done, expected, n)) {
+         size_t i;
+         for (i= 0; in[done + i] == expected[i]; ++i) {}
+         /* Position the stream at the differing byte. */
+         *po= piece;
+         pearnd_generate(expected, i, po);
+         return done + i;
+      }
+      done+= n;
+   }
+   return count;
+}
+
+void pearnd_generate_nt(void *dst, size_t count, pearnd_offset *po) {
+#ifdef __SSE2__
+   /* Generate into a small buffer which stays in the L1 cache, and stream
+    * it out from there 16 bytes at a time. */
+   union { __m128i v[16]; uint8_t b[256]; } block;
+   uint8_t *out= dst;
+   /* Make the first chunk end at a 16 byte boundary of <dst>. */
+   size_t n= sizeof block - (size_t)((uintptr_t)out % sizeof *block.v);
+   while (count) {
+      if (n > count) n= count;
+      pearnd_generate(block.b, n, po);
+      if ((uintptr_t)out % sizeof *block.v || n % sizeof *block.v) {
+         memcpy(out, block.b, n);
+      } else {
+         unsigned i;
+         for (i= 0; i < n / sizeof *block.v; ++i) {
+            _mm_stream_si128((__m128i *)out + i, block.v[i]);
+         }
+      }
+      out+= n; count-= n;
+      n= sizeof block;
+   }
+   _mm_sfence();
+#else
+   pearnd_generate(dst, count, po);
+#endif
 }
@@ -5,7 +5,9 @@ SOURCES = \
 	getopt_simplest_mand_arg.c \
 	getopt_simplest_perror_missing_arg.c \
 	getopt_simplest_perror_opt.c \
+	pattern.c \
 	pearnd.c \
 	release_c1.c \
 	release_to_c1.c \
+	xxh64.c \
 
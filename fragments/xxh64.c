@@ -0,0 +1,79 @@
+#include <xxh64.h>
+
+#define P1 UINT64_C(0x9e3779b185ebca87)
+#define P2 UINT64_C(0xc2b2ae3d27d4eb4f)
+#define P3 UINT64_C(0x165667b19e3779f9)
+#define P4 UINT64_C(0x85ebca77c2b2ae63)
+#define P5 UINT64_C(0x27d4eb2f165667c5)
+
+#define ROTL(v, bits) ((v) << (bits) | (v) >> (64 - (bits)))
+
+/* Reads the data as little endian, independent of the platform. */
+static uint64_t read64(uint8_t const *p) {
+   return
+         (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16
+      |  (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40
+      |  (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56
+   ;
+}
+
+static uint64_t read32(uint8_t const *p) {
+   return
+         (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16
+      |  (uint64_t)p[3] << 24
+   ;
+}
+
+static uint64_t round64(uint64_t acc, uint64_t input) {
+   acc+= input * P2;
+   acc= ROTL(acc, 31);
+   return acc * P1;
+}
+
+static uint64_t merge_round(uint64_t acc, uint64_t val) {
+   acc^= round64(0, val);
+   return acc * P1 + P4;
+}
+
+uint_fast64_t xxh64(void const *data, size_t count, uint_fast64_t seed) {
+   uint8_t const *p= data, *const stop= p + count;
+   uint64_t h;
+   if (count >= 32) {
+      uint8_t const *const limit= stop - 32;
+      uint64_t
+            v1= (uint64_t)seed + P1 + P2, v2= (uint64_t)seed + P2
+         ,  v3= (uint64_t)seed, v4= (uint64_t)seed - P1
+      ;
+      do {
+         v1= round64(v1, read64(p)); p+= 8;
+         v2= round64(v2, read64(p)); p+= 8;
+         v3= round64(v3, read64(p)); p+= 8;
+         v4= round64(v4, read64(p)); p+= 8;
+      } while (p <= limit);
+      h= ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+      h= merge_round(h, v1);
+      h= merge_round(h, v2);
+      h= merge_round(h, v3);
+      h= merge_round(h, v4);
+   } else {
+      h= (uint64_t)seed + P5;
+   }
+   h+= (uint64_t)count;
+   for (; p + 8 <= stop; p+= 8) {
+      h^= round64(0, read64(p));
+      h= ROTL(h, 27) * P1 + P4;
+   }
+   if (p + 4 <= stop) {
+      h^= read32(p) * P1;
+      h= ROTL(h, 23) * P2 + P3;
+      p+= 4;
+   }
+   for (; p < stop; ++p) {
+      h^= *p * P5;
+      h= ROTL(h, 11) * P1;
+   }
+   h^= h >> 33; h*= P2;
+   h^= h >> 29; h*= P3;
+   h^= h >> 32;
+   return h;
+}
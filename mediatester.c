@@ -8,8 +8,8 @@
  * to allow disk I/O to run (mostly) in parallel, too. */
 
 #define VERSION_INFO \
- "Version 2022.42\n" \
- "Copyright (c) 2017-2022 Guenther Brunthaler. All rights reserved." \
+ "Version 2026.291\n" \
+ "Copyright (c) 2017-2026 Guenther Brunthaler. All rights reserved." \
  "\n" \
  "This program is free software.\n" \
  "Distribution is permitted under the terms of the GPLv3."
@@ -30,7 +30,9 @@
 #ifndef _GNU_SOURCE
    /* Enable the following required definitions:
     * MAP_ANONYMOUS <sys/mman.h>
-    * SYS_ioprio_set <sys/syscall.h> */
+    * SYS_ioprio_set <sys/syscall.h>
+    * sync_file_range() <fcntl.h>
+    * fallocate() <fcntl.h> */
     #define _GNU_SOURCE
 #endif
 
@@ -38,10 +40,13 @@
 #include <dim_sdbrke8ae851uitgzm4nv3ea2.h>
 #include <getopt_nh7lll77vb62ycgwzwf30zlln.h>
 #include <pearson.h>
+#include <pattern.h>
+#include <xxh64.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <locale.h>
 #include <string.h>
+#include <ctype.h>
 #include <stddef.h>
 #include <assert.h>
 #include <errno.h>
@@ -58,16 +63,78 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/resource.h>
+#include <fcntl.h>
 #include <linux/fs.h>
 #include <linux/ioprio.h>
+#include <linux/perf_event.h>
 
 /* TWO such buffers will be allocated. */
 #define APPROXIMATE_BUFFER_SIZE (16ul << 20)
 
+#define CEIL_DIV(num, den) (((num) + (den) - 1) / (den))
+
+/* I/O request latencies are counted in logarithmic buckets, each power of
+ * two being split into 2 ** LATENCY_SUB_BITS linear sub-buckets (like in
+ * HdrHistogram). This keeps the relative error below 1 / 2 **
+ * LATENCY_SUB_BITS for any latency in nanoseconds. */
+#define LATENCY_SUB_BITS 4
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+struct latency_histogram {
+   uint_fast64_t requests, max_ns;
+   uint_fast64_t count[LATENCY_BUCKETS];
+};
+
+/* Hardware events counted by -H, in the order of perf_configs[]. */
+enum {
+   perf_cycles, perf_instructions, perf_cache_misses, perf_branch_misses
+,  PERF_COUNTERS
+};
+
+/* The phases of the threaded modes measured separately by -H. */
+enum { perf_processing, perf_io, PERF_PHASES };
+
+/* Reference data for verifying several inputs with -i is generated in
+ * segments of MULTI_SEGMENT_SIZE into a ring of MULTI_RING_DEPTH of them.
+ * Faster inputs can run ahead of the slowest one by this many segments. */
+#define MULTI_SEGMENT_SIZE (UINT32_C(4) << 20)
+#define MULTI_RING_DEPTH 8
+
+/* The threads of the engine selected by -I claim segments of about
+ * PARALLEL_SEGMENT_SIZE. They may get ahead of the oldest unfinished
+ * segment by PARALLEL_WINDOW segments per thread. */
+#define PARALLEL_SEGMENT_SIZE (UINT32_C(1) << 20)
+#define PARALLEL_WINDOW 4
+
+/* Default size of the requests of the 'mixed' mode. */
+#define MIXED_CHUNK_SIZE (UINT32_C(64) << 10)
+
+/* With -T, every sector of STAMP_SECTOR_SIZE starts with a header of
+ * STAMP_HEADER_SIZE instead of stream data: Its own byte offset and the
+ * fingerprint of the seed, both as 64 bit little endian words. */
+#define STAMP_SECTOR_SIZE 512
+#define STAMP_HEADER_SIZE 16
+
+/* Runs of sectors found to be stamped for other offsets are listed, up to
+ * this many. */
+#define STAMP_MAX_RUNS 16
+
+/* Consecutive sectors from <pos> up to <end> which contain the data
+ * stamped for the sectors starting at byte offset <source>. */
+struct stamp_run {
+   uint_fast64_t pos, end, source;
+};
+
+/* Holes of a sparse input are recorded for every shared buffer, up to
+ * this many. Any further holes within the same buffer are just read. */
+#define HOLES_PER_BUFFER 64
+
 /* Global variables, grouped in a struct for easier tracking. */
 static struct {
    enum {
       mode_write, mode_verify, mode_compare, mode_diff
+   ,  mode_fill, mode_check, mode_iops, mode_digest, mode_verify_digest
+   ,  mode_mixed
    } mode;
    int shutdown_requested /* = 0; */;
    uint8_t *shared_buffer, *shared_buffers[2];
@@ -79,10 +146,218 @@ static struct {
    uint_fast64_t pos; /* Current position for next working segment. */
    uint_fast64_t start_pos; /* Initial starting offset. */
    uint_fast64_t first_error_pos; /* Only valid if num_errors != 0. */
-   uint_fast32_t num_errors; /* Count of differing bytes. */
+   uint_fast64_t num_errors; /* Count of differing bytes. */
    unsigned active_threads; /* Number of threads not waiting for more work. */
+   unsigned threads; /* Total number of worker threads. */
+   unsigned busy_workers; /* Number of threads generating PRNG data. */
+   unsigned max_busy_workers; /* Upper limit for <busy_workers>. */
+   unsigned parked_threads; /* Threads waiting in <workers_parking_lot>. */
+   int adaptive; /* Adjust <max_busy_workers> to measured output speed. */
+   uint_fast64_t switch_ns; /* Time of the last buffer switch. */
+   uint_fast64_t generated_ns; /* When the last buffer had been generated. */
+   uint_fast64_t io_ns; /* Duration of the last buffer's output. */
+   struct {
+      uint8_t *ready; /* Flags for the segments of all shared buffers. */
+      uint_fast64_t claimed; /* Segments claimed for generation so far. */
+      uint_fast64_t written; /* Segments written so far. */
+      uint_fast64_t io_ns; /* Time spent writing the current buffer. */
+      /* Segments generated of the rounds of <work_segments> claims,
+       * indexed modulo 3. Claiming can only get 2 buffers ahead of
+       * writing, so at most 3 consecutive rounds are in progress. */
+      size_t generated[3];
+      int writing; /* Some thread is writing segments right now. */
+   } pipeline; /* The shared buffers as a ring of segments in write mode. */
+   struct {
+      uint_fast64_t rate; /* Maximum bytes per second, or 0 for no limit. */
+      uint_fast64_t tokens; /* Bytes which may be transferred right now. */
+      uint_fast64_t updated_ns; /* When <tokens> has been refilled. */
+      size_t chunk; /* Maximum size of a single paced I/O request. */
+      unsigned from_hour, to_hour; /* Limit only during those hours. */
+      pthread_mutex_t mutex; /* Serialize threads doing I/O concurrently. */
+   } throttle; /* Token bucket shared by all threads doing I/O. */
+   struct {
+      FILE *log; /* Throughput log file, or null. */
+      uint_fast64_t extent; /* Granularity of measurements, or 0 for none. */
+      uint_fast64_t min_rate; /* Report extents slower than this. */
+      uint_fast64_t pos; /* Starting offset of the current extent. */
+      uint_fast64_t bytes; /* Bytes transferred within current extent. */
+      uint_fast64_t ns; /* Time spent in I/O for the current extent. */
+      struct slow_region {
+         uint_fast64_t pos, bytes, ns;
+      } *slow; /* Adjacent slow extents merged into regions. */
+      size_t slow_regions, slow_allocated; /* Used/allocated <slow>. */
+   } tput; /* Throughput measurement of the thread currently doing I/O. */
+   struct {
+      int fd; /* Block device to be discarded. */
+      unsigned pre, post; /* Index into discard_kinds[] plus 1, or 0. */
+      unsigned long request; /* ioctl() request of the current pass. */
+      uint_fast64_t pos, end; /* Remaining range of the current pass. */
+   } discard;
+   struct {
+      uint_fast64_t limit; /* Maximum dirty bytes, or 0 for no control. */
+      uint_fast64_t started; /* Writeback has been started before this. */
+      uint_fast64_t done; /* Everything before this has been written. */
+   } writeback; /* Page cache writeback control in write mode. */
+   struct {
+      int fd; /* The directory containing the files. */
+      uint_fast64_t file_size; /* Size of every file (except the last). */
+      unsigned streams; /* Number of files processed concurrently. */
+      unsigned next; /* Index of the next file to be processed. */
+      unsigned stop; /* Index of the first file not to be processed. */
+      unsigned files; /* Number of files processed. */
+      uint_fast64_t bytes; /* Total bytes processed. */
+   } dir; /* For the directory modes. */
+   struct {
+      FILE *map; /* Unreadable extents are logged here. 0 = disabled. */
+      size_t sector; /* Smallest unit which can fail to be read. */
+      uint_fast64_t skip; /* Next skip distance after a bad sector. */
+      uint_fast64_t skip_until; /* Don't try reading before this offset. */
+      uint_fast64_t end; /* Size of the input. Never skip beyond it. */
+      /* For 'compare': Nonzero for the unreadable bytes of the shared
+       * buffer, which only contain the expected data. */
+      uint8_t *mask;
+      uint_fast64_t pos, bytes; /* Unreadable extent not yet logged. */
+      uint_fast64_t total, extents; /* All unreadable extents so far. */
+   } salvage; /* Error-tolerant reading. */
+   struct {
+      uint8_t *base; /* Buffer currently being processed by the workers. */
+      uint_fast64_t base_pos; /* Stream offset of <base>. */
+      uint_fast64_t pos; /* Stream offset of the next read(). */
+      size_t ahead; /* Bytes already read into the other buffer. */
+      int primed; /* <ahead> and <base> are valid. */
+   } input; /* For the threaded read modes. */
+   struct {
+      int enabled; /* Verifying a regular file, which might be sparse. */
+      struct hole {
+         size_t start, end; /* Relative to the start of the buffer. */
+      } list[2][HOLES_PER_BUFFER]; /* For either of the shared buffers. */
+      unsigned count[2];
+      unsigned current; /* Index of the lists for <input.base>. */
+      uint_fast64_t pos, bytes; /* Adjacent holes not yet reported. */
+      uint_fast64_t total, extents; /* All holes so far. */
+   } holes; /* Skipped by 'verify' rather than read and compared. */
+   struct {
+      FILE *manifest;
+      size_t block; /* Size of the hashed blocks. */
+      uint_fast64_t *hashes[2]; /* For either of the shared buffers. */
+      uint_fast64_t *current; /* Hashes of the blocks in <input.base>. */
+      uint_fast64_t blocks; /* Blocks hashed or verified. */
+   } digest; /* For the digest modes. */
+   struct {
+      int enabled;
+      uint_fast64_t bits; /* Total differing bits. */
+      /* Per bit position: Expected 0 but read 1, expected 1 but read 0. */
+      uint_fast64_t flips[8][2];
+      /* Regions with 1-9, 10-99, ... differing bytes. */
+      uint_fast64_t density[6];
+      uint_fast64_t worst_pos, worst; /* Region with most differing bytes. */
+   } stats; /* Error statistics of 'verify' with -x. */
+   size_t compressible; /* Bytes at the end of every COMPRESSIBLE_UNIT. */
+   int nt_stores; /* Generate with non-temporal stores in write mode. */
+   struct {
+      int enabled;
+      pattern kind;
+   } pattern; /* Fixed test pattern selected by -p instead of the PRNG. */
+   struct {
+      int enabled;
+      uint_fast64_t fingerprint; /* Of the seed, stamped into sectors. */
+      uint_fast64_t aliased; /* Sectors stamped for other offsets. */
+      uint_fast64_t foreign; /* Sectors without a valid stamp. */
+      struct stamp_run runs[STAMP_MAX_RUNS]; /* Lowest offsets first. */
+      unsigned num_runs;
+      int truncated; /* More <runs> than could be listed. */
+   } stamps; /* Sector stamps of -T. */
+   uint_fast64_t length; /* Of the tested range. 0 = up to the end. */
+   struct {
+      enum {
+         order_sequential, order_reverse, order_stride, order_random
+      } kind;
+      uint_fast64_t stride; /* Distance in chunks for order_stride. */
+      size_t chunk; /* Size of the chunks being reordered. */
+      uint_fast64_t chunks; /* Number of chunks in the range. */
+      uint_fast64_t next; /* Next position within the order to be claimed. */
+      uint_fast64_t keys[4]; /* Round keys for order_random. */
+      unsigned half_bits; /* Bits per half of the Feistel network. */
+      int fd;
+   } order; /* For writing or verifying in non-sequential order. */
+   struct {
+      int enabled;
+      int fd; /* Open for reading and writing when writing. */
+      uint_fast64_t next; /* Offset of the next chunk to be claimed. */
+      uint_fast64_t end; /* Of the range, or where the filesystem is full. */
+   } mapped; /* For the memory-mapped engine selected by -M. */
+   struct {
+      int enabled;
+      int fd;
+      size_t segment; /* Size of the segments, a multiple of tgs.blksz. */
+      unsigned window; /* Maximum number of segments claimed ahead. */
+      uint8_t *finished; /* Flags for the segments within the window. */
+      uint_fast64_t next; /* Index of the next segment to be claimed. */
+      uint_fast64_t oldest; /* Index of the oldest unfinished segment. */
+      uint_fast64_t end; /* Of the range, or where the data ended. */
+   } parallel; /* For the engine selected by -I. */
+   struct {
+      struct mixed_direction {
+         uint_fast64_t next; /* Offset of the next chunk to be claimed. */
+         uint_fast64_t end; /* Of the region. */
+         uint_fast64_t requests; /* Chunks claimed so far. */
+         uint_fast64_t bytes; /* Transferred so far. */
+         uint_fast64_t last_ns; /* When the last chunk was completed. */
+         struct latency_histogram latency;
+      } dirs[2]; /* Verifying region A, writing region B. */
+      uint_fast64_t region_b; /* Size of region B, 0 for the size of A. */
+      unsigned read_percent; /* Share of the reads among all requests. */
+      int fd; /* Open for reading and writing. */
+   } mixed; /* For the 'mixed' mode. */
+   struct {
+      struct multi_input {
+         char const *path;
+         int fd;
+         uint8_t *buffer; /* For reading the current segment. */
+         uint_fast64_t segment; /* Index of the current segment. */
+         uint_fast64_t bytes; /* Verified so far. */
+         uint_fast64_t differences, first_difference;
+         uint_fast64_t ns; /* How long verification took. */
+         int error; /* errno of a read error, or 0. */
+         int done; /* End of input or read error. */
+      } inputs[16];
+      unsigned count; /* Number of valid <inputs>. */
+      unsigned roles; /* Threads become readers of <inputs> first. */
+      unsigned active; /* Inputs not yet done. */
+      uint8_t *ring; /* MULTI_RING_DEPTH segments of reference data. */
+      uint_fast64_t ready[MULTI_RING_DEPTH]; /* Segment index + 1 or 0. */
+      uint_fast64_t next; /* Index of the next segment to be generated. */
+      uint_fast64_t oldest; /* Of all segments still being compared. */
+      uint_fast64_t segments; /* In the range, or 0 for no limit. */
+      uint_fast64_t started_ns;
+   } multi; /* For verifying several inputs specified with -i at once. */
+   struct {
+      int fd; /* Opened for direct I/O if possible. */
+      uint_fast64_t seconds; /* Duration of every test. */
+      uint_fast64_t sizes[8], depths[8]; /* Test every combination. */
+      unsigned num_sizes, num_depths;
+      size_t size; /* Of the requests in the current test. */
+      uint_fast64_t blocks; /* Number of such requests in the range. */
+      uint_fast64_t deadline_ns; /* When the current test ends. */
+      unsigned seeds; /* Different random sequence for every thread. */
+   } iops; /* For random read IOPS measurements. */
+   struct latency_histogram latency; /* Of the I/O requests. */
+   struct {
+      int enabled; /* -H has been specified and counters are available. */
+      int exclude_kernel; /* Only user space is permitted to be counted. */
+      unsigned threads, failed; /* With and without their own counters. */
+      uint_fast64_t counts[PERF_PHASES][PERF_COUNTERS];
+      uint_fast64_t bytes[PERF_PHASES]; /* Processed during either phase. */
+   } perf; /* Hardware performance counters. */
+   uint_fast64_t stall_ns; /* Warn about longer I/O requests unless 0. */
+   struct {
+      uint_fast64_t interval_ns; /* Report interval, or 0 for none. */
+      uint_fast64_t last_ns; /* Time of the last report. */
+      uint_fast64_t bytes; /* Transferred since the last report. */
+   } progress;
    pthread_mutex_t workers_mutex; /* Serialize access to THIS struct. */
    pthread_cond_t workers_wakeup_call; /* Wake up threads for more work. */
+   pthread_cond_t workers_parking_lot; /* Wake up threads not needed before. */
    pthread_key_t resource_context; /* For r4g_c1(). */
 } tgs; /* Thread global storage */
 
@@ -119,6 +394,11 @@ static void pthread_cond_broadcast_c1(pthread_cond_t *cond) {
    ERROR_C1("Could not wake up worker threads!");
 }
 
+static void pthread_cond_signal_c1(pthread_cond_t *cond) {
+   if (!pthread_cond_signal(cond)) return;
+   ERROR_C1("Could not wake up worker thread!");
+}
+
 static void pthread_cond_wait_c1(
    pthread_cond_t *restrict cond, pthread_mutex_t *restrict mutex
 ) {
@@ -185,612 +465,4251 @@ static int *mutex_unlocker_c5(pthread_mutex_t *mutex) {
    return &r->procured;
 }
 
-static void *writer_thread(void *unused_dummy) {
-   r4g *rc;
-   int *workers_mutex_procured;
-   (void)unused_dummy;
-   {
-      char const *error;
-      if (error= new_r4g_thread_context_c0()) return (void *)error;
-   }
-   rc= r4g_c1();
-   workers_mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
-   assert(!*workers_mutex_procured);
-   /* Lock the mutex before acessing the global work state variables. */
-   pthread_mutex_lock_c1(&tgs.workers_mutex);
-   *workers_mutex_procured= 1;
-   ++tgs.active_threads; /* We just have started. */
-   /* Thread main loop. */
-   for (;;) {
-      assert(*workers_mutex_procured);
-      assert(tgs.active_threads >= 1);
-      if (tgs.shutdown_requested) {
-         shutdown:
-         --tgs.active_threads;
-         break;
-      }
-      if (tgs.shared_buffer == tgs.shared_buffer_stop) {
-         /* All worker segments have already been assigned to some
-          * thread. */
-         if (tgs.active_threads == 1) {
-            /* And we are the first/last thread running! Let's do I/O then.
-             * We switch the buffer first, and let then the other threads
-             * fill the next buffer while we write out the old buffer's
-             * contents. */
-            uint8_t const *out;
-            size_t left;
-            uint_fast64_t pos;
-            /* Switch buffers so other threads can resume working. */
-            if (
-                  tgs.shared_buffer - (left= tgs.shared_buffer_size)
-               == tgs.shared_buffers[0]
-            ) {
-               out= tgs.shared_buffers[0];
-               tgs.shared_buffer= tgs.shared_buffers[1];
-            } else {
-               out= tgs.shared_buffers[1];
-               assert(tgs.shared_buffer - left == out);
-               tgs.shared_buffer= tgs.shared_buffers[0];
-            }
-            pos= tgs.pos - left;
-            tgs.shared_buffer_stop= tgs.shared_buffer + left;
-            assert(*workers_mutex_procured);
-            *workers_mutex_procured= 0;
-            pthread_mutex_unlock_c1(&tgs.workers_mutex);
-            /* Wake up the other threads so they can start working on the
-             * other buffer. */
-            pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
-            /* Write out the old buffer while the other threads already fill
-             * the new buffer. */
-            for (;;) {
-               ssize_t written;
-               if ((written= write(STDOUT_FILENO, out, left)) <= 0) {
-                  if (written == 0) break;
-                  if (written != -1) {
-                     unlikely_error: ERROR_C1(msg_exotic_error);
-                  }
-                  /* The write() has failed. Examine why. */
-                  switch (errno) {
-                     case ENOSPC: /* We filled up the filesystem. */
-                     case EPIPE: /* Output stream has ended. */
-                     case EDQUOT: /* Quota has been reached. */
-                     case EFBIG: /* Maximum file/device size reached. */
-                        /* Those are all considered "good" reasons why the
-                         * write() has failed. */
-                        assert(left > 0);
-                        goto finished;
-                     case EINTR: continue; /* Interrupted write(). */
-                  }
-                  assert(pos >= tgs.start_pos);
-                  (void)fprintf(
-                        stderr
-                     ,  "Write error at byte offset %" PRIuFAST64 "!\n"
-                        "(Output did start at byte offset %" PRIuFAST64 ")\n"
-                        "Total bytes written so far: %" PRIuFAST64 "\n"
-                     ,  pos, tgs.start_pos, pos - tgs.start_pos
-                  );
-                  error_c1(rc, msg_write_error);
-               }
-               if ((size_t)written > left) goto unlikely_error;
-               out+= (size_t)written;
-               pos+= (uint_fast64_t)written;
-               left-= (size_t)written;
-            }
-            finished:
-            assert(!*workers_mutex_procured);
-            pthread_mutex_lock_c1(&tgs.workers_mutex);
-            *workers_mutex_procured= 1;
-            if (left) {
-               /* Output data sink does not accept any more data - we are
-                * done. Try to write some statistics to standard error. */
-               assert(pos >= tgs.start_pos);
-               fprintf_c1(
-                     stderr
-                  ,  "\n"
-                     "Success!\n"
-                     "\n"
-                     "Output stopped at byte offset %" PRIuFAST64 "!\n"
-                     "(Output did start at byte offset %" PRIuFAST64 ")\n"
-                     "Total bytes written: %" PRIuFAST64 "\n"
-                  ,  pos, tgs.start_pos, pos - tgs.start_pos
-               );
-               /* Initiate successful termination. */
-               tgs.shutdown_requested= 1;
-               /* Make sure any sleeping threads will wake up to learn
-                * about the shutdown request. */
-               pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
-               goto shutdown;
-            }
-         } else {
-            assert(tgs.active_threads >= 2);
-            /* We have nothing to do, but other worker threads are still
-             * active. Just wait until there is again possibly something to
-             * do. */
-            --tgs.active_threads;
-            assert(*workers_mutex_procured);
-            *workers_mutex_procured= 0;
-            /* Unlock mutex, wait for a broadcast, then lock mutex again. */
-            pthread_cond_wait_c1(
-               &tgs.workers_wakeup_call, &tgs.workers_mutex
-            );
-            *workers_mutex_procured= 1;
-            ++tgs.active_threads;
-         }
-      } else {
-         /* There is more work to do. Seize the next work segment. */
-         pearnd_offset po;
-         uint8_t *work_segment= tgs.shared_buffer;
-         tgs.shared_buffer+= tgs.work_segment_sz;
-         pearnd_seek(&po, tgs.pos);
-         tgs.pos+= tgs.work_segment_sz;
-         /* Allow other threads to seize work segments as well. */
-         *workers_mutex_procured= 0;
-         pthread_mutex_unlock_c1(&tgs.workers_mutex);
-         /* Do every worker thread's primary job: Process its work
-          * segment. */
-         pearnd_generate(work_segment, tgs.work_segment_sz, &po);
-         /* See whether we can get the next job. */
-         pthread_mutex_lock_c1(&tgs.workers_mutex);
-         *workers_mutex_procured= 1;
+static uint64_t const perf_configs[PERF_COUNTERS]= {
+   PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS
+,  PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/* Opens a group of counters for all perf_configs[] of the calling thread
+ * into <fd>. Returns 0 on success, or -1 if the hardware or the system
+ * does not permit this. */
+static int open_perf_counters(int fd[PERF_COUNTERS], int exclude_kernel) {
+   unsigned i;
+   for (i= 0; i < PERF_COUNTERS; ++i) {
+      struct perf_event_attr attr;
+      long rc;
+      memset(&attr, 0, sizeof attr);
+      attr.size= sizeof attr;
+      attr.type= PERF_TYPE_HARDWARE;
+      attr.config= perf_configs[i];
+      attr.read_format= PERF_FORMAT_GROUP;
+      attr.exclude_kernel= exclude_kernel ? 1 : 0;
+      attr.exclude_hv= 1;
+      if (
+         (
+            rc= syscall(
+                  SYS_perf_event_open, &attr, 0, -1, i ? fd[0] : -1
+               ,  PERF_FLAG_FD_CLOEXEC
+            )
+         ) < 0
+      ) {
+         while (i--) (void)close(fd[i]);
+         return -1;
       }
+      fd[i]= (int)rc;
    }
-   release_c1(rc);
-   return (void *)rc->static_error_message;
+   return 0;
 }
 
-static void *reader_thread(void *unused_dummy) {
+struct perf_resource {
+   int fd[PERF_COUNTERS];
+   uint64_t started[PERF_COUNTERS]; /* Counter values when phase began. */
+   r4g_dtor dtor, *saved;
+};
+
+static void perf_counters_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct perf_resource, *r=, rc, dtor);
+   unsigned i;
+   rc->rlist= r->saved;
+   for (i= PERF_COUNTERS; i--; ) (void)close(r->fd[i]);
+   free(r);
+}
+
+/* Opens the counters of the calling thread if -H is in effect. Returns 0
+ * if it is not, or if the counters could not be opened for this thread.
+ * A resource is added to the current resource list which closes them. */
+static struct perf_resource *perf_counters_c5(void) {
    r4g *rc;
-   int *workers_mutex_procured;
-   (void)unused_dummy;
-   {
-      char const *error;
-      if (error= new_r4g_thread_context_c0()) return (void *)error;
-   }
+   struct perf_resource *r;
+   int ok;
+   if (!tgs.perf.enabled) return 0;
    rc= r4g_c1();
-   workers_mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
-   assert(!*workers_mutex_procured);
-   /* Lock the mutex before acessing the global work state variables. */
+   r= malloc_c1(sizeof *r);
+   ok= !open_perf_counters(r->fd, tgs.perf.exclude_kernel);
    pthread_mutex_lock_c1(&tgs.workers_mutex);
-   *workers_mutex_procured= 1;
-   ++tgs.active_threads; /* We just have started. */
-   /* Thread main loop. */
-   for (;;) {
-      assert(*workers_mutex_procured);
-      assert(tgs.active_threads >= 1);
-      error_c1(rc, "Verify mode has not been implemented yet!");
+   ++*(ok ? &tgs.perf.threads : &tgs.perf.failed);
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   if (!ok) {
+      free(r);
+      return 0;
    }
-   release_c1(rc);
-   return (void *)rc->static_error_message;
+   r->saved= rc->rlist; r->dtor= &perf_counters_dtor; rc->rlist= &r->dtor;
+   return r;
 }
-              
-static uint_fast64_t atou64(char const *numeric) {
-   uint_fast64_t result;
-   int converted;
+
+static void read_perf_counters(
+   struct perf_resource const *pc, uint64_t values[PERF_COUNTERS]
+) {
+   uint64_t group[1 + PERF_COUNTERS];
    if (
-         sscanf(numeric, "%" SCNuFAST64 "%n", &result, &converted) != 1
-      || (size_t)converted != strlen(numeric)
+         read(pc->fd[0], group, sizeof group) != (ssize_t)sizeof group
+      || group[0] != PERF_COUNTERS
    ) {
-      ERROR_C1("Invalid number!");
+      ERROR_C1("Could not read hardware performance counters!");
    }
-   return result;
+   memcpy(values, group + 1, sizeof group - sizeof *group);
 }
 
-struct FILE_mallocated_resource {
-   FILE *handle;
-   r4g_dtor dtor, *saved;
-};
+/* Marks the beginning of a measured phase of the calling thread. */
+static void perf_begin(struct perf_resource *pc) {
+   if (pc) read_perf_counters(pc, pc->started);
+}
 
-static void FILE_mallocated_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct FILE_mallocated_resource, *r=, rc, dtor);
-   FILE *fh= r->handle;
-   rc->rlist= r->saved;
-   free(r);
-   if (fh && fclose(fh)) error_c1(rc, "Error while closing file!");
+/* Adds the events since perf_begin() to the totals of <phase>, which has
+ * processed <bytes>. Locks <tgs.workers_mutex> for this, so it must not be
+ * locked already. */
+static void perf_end(
+   struct perf_resource const *pc, unsigned phase, uint_fast64_t bytes
+) {
+   uint64_t now[PERF_COUNTERS];
+   unsigned i;
+   if (!pc) return;
+   read_perf_counters(pc, now);
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   for (i= 0; i < PERF_COUNTERS; ++i) {
+      tgs.perf.counts[phase][i]+= now[i] - pc->started[i];
+   }
+   tgs.perf.bytes[phase]+= bytes;
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
 }
 
-static void load_seed(char const *seed_file) {
-   struct FILE_mallocated_resource *f= malloc_c1(sizeof *f);
-   FILE *fh;
-   r4g *rc;
-   r4g_dtor *marker;
-   f->saved= marker= (rc= r4g_c1())->rlist; f->dtor= &FILE_mallocated_dtor;
-   rc->rlist= &f->dtor;
-   if (!(f->handle= fh= fopen(seed_file, "rb"))) {
-      rd_err: error_c1(rc, "Cannot read seed file!");
+/* Returns the current value of the monotonic system clock in nanoseconds. */
+static uint_fast64_t monotonic_ns(void) {
+   struct timespec now;
+   if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) ERROR_C1(msg_exotic_error);
+   return (uint_fast64_t)now.tv_sec * 1000000000u + (uint_fast64_t)now.tv_nsec;
+}
+
+/* Called with <tgs.workers_mutex> locked when the buffers are about to be
+ * switched. Compares how long the last <tgs.max_busy_workers> threads needed
+ * for generating the buffer which is about to be written against how long it
+ * took to write the preceding buffer, and adjusts the number of busy threads
+ * so that generating a buffer will take about 80 % of the time required for
+ * writing it. More threads are added immediately when needed, but the number
+ * of threads is only reduced one at a time in order to avoid oscillation. */
+static void adapt_busy_workers(void) {
+   uint_fast64_t now= monotonic_ns();
+   if (tgs.io_ns && tgs.generated_ns > tgs.switch_ns) {
+      uint_fast64_t wanted= CEIL_DIV(
+            (uint_fast64_t)tgs.max_busy_workers
+            * (tgs.generated_ns - tgs.switch_ns) * 5
+         ,  tgs.io_ns * 4
+      );
+      if (wanted > tgs.threads) wanted= tgs.threads;
+      if (wanted < tgs.max_busy_workers) wanted= tgs.max_busy_workers - 1;
+      if (!wanted) wanted= 1;
+      tgs.max_busy_workers= (unsigned)wanted;
    }
+   tgs.switch_ns= now;
    {
-      #define MAX_SEED_BYTES 256
-      char seed[MAX_SEED_BYTES + 1]; /* 1 byte larger than actually allowed. */
-      #undef MAX_SEED_BYTES
-      size_t read;
-      if ((read= fread(seed, sizeof *seed, DIM(seed), fh)) == DIM(seed)) {
-         error_c1(
-            rc, "Key file for seeding the PRNG is larger than supported!"
-         );
+      /* Unpark threads if not enough of them are waiting for a wakeup call.
+       * Ignore the current thread because it is about to do I/O. */
+      unsigned available= tgs.threads - tgs.parked_threads - 1;
+      if (available < tgs.max_busy_workers) {
+         unsigned wake= tgs.max_busy_workers - available;
+         if (wake > tgs.parked_threads) wake= tgs.parked_threads;
+         while (wake--) pthread_cond_signal_c1(&tgs.workers_parking_lot);
       }
-      if (ferror(fh)) goto rd_err;
-      assert(feof(fh));
-      if (!read) error_c1(rc, "Seed file must not be empty!");
-      pearnd_init(seed, read);
    }
-   release_to_c1(rc, marker);
 }
 
-static void slow_comparison(void) {
-   uint_fast64_t differences= 0;
-   uint_fast64_t pos;
-   pearnd_offset po;
-   uint8_t *const reference= tgs.shared_buffers[1];
-   /* Write a header. */
-   fprintf_c1(stderr, "\nEX RD A %-8s BYTE OFFSET\n", "XOR");
-   pearnd_seek(&po, pos= tgs.pos);
-   for (;;) {
-      uint8_t *in= tgs.shared_buffer;
-      size_t left= tgs.shared_buffer_size;
-      /* Read the next buffer full of input data. */
+/* Returns whether the current local time is within the hours of the day
+ * where the maximum I/O rate applies. */
+static int throttle_scheduled(void) {
+   unsigned from= tgs.throttle.from_hour, to= tgs.throttle.to_hour, hour;
+   if (from == to) return 1;
+   {
+      time_t now;
+      struct tm local;
+      if (time(&now) == (time_t)-1 || !localtime_r(&now, &local)) {
+         ERROR_C1(msg_exotic_error);
+      }
+      hour= (unsigned)local.tm_hour;
+   }
+   return from < to ? hour >= from && hour < to : hour >= from || hour < to;
+}
+
+static void sync_file_range_c1(
+   uint_fast64_t from, uint_fast64_t to, unsigned flags
+) {
+   if (from >= to) return;
+   if (
+      sync_file_range(
+         STDOUT_FILENO, (off_t)from, (off_t)(to - from), flags
+      )
+   ) {
+      (void)fprintf(
+            stderr
+         ,  "Writeback of byte offsets %" PRIuFAST64 " through %" PRIuFAST64
+            " has failed: %s\n"
+         ,  from, to - 1, strerror(errno)
+      );
+      ERROR_C1(msg_write_error);
+   }
+   if (flags & SYNC_FILE_RANGE_WAIT_AFTER) {
+      /* The data has been written and is not needed in the cache any
+       * longer. */
+      (void)posix_fadvise(
+         STDOUT_FILENO, (off_t)from, (off_t)(to - from), POSIX_FADV_DONTNEED
+      );
+   }
+}
+
+/* Called after the output has been written up to byte offset <pos>. Starts
+ * writeback of everything written so far, and waits for the writeback of
+ * older data to complete as far as necessary in order to keep the amount of
+ * dirty data in the page cache below the limit. If <pos> is the end of the
+ * output, waits until all writeback has completed. */
+static void control_writeback(uint_fast64_t pos, int end) {
+   sync_file_range_c1(
+      tgs.writeback.started, pos, SYNC_FILE_RANGE_WRITE
+   );
+   tgs.writeback.started= pos;
+   if (!end) {
+      if (pos - tgs.writeback.done <= tgs.writeback.limit) return;
+      pos-= tgs.writeback.limit;
+   }
+   sync_file_range_c1(
+         tgs.writeback.done, pos
+      ,     SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+         |  SYNC_FILE_RANGE_WAIT_AFTER
+   );
+   tgs.writeback.done= pos;
+}
+
+/* Returns how many of the <wanted> bytes the thread doing I/O may transfer
+ * next, after sleeping long enough for staying below the maximum I/O rate.
+ * This is a token bucket which holds at most one chunk worth of tokens. */
+static size_t throttle_c1(size_t wanted) {
+   uint_fast64_t now, elapsed;
+   if (!tgs.throttle.rate) return wanted;
+   if (wanted > tgs.throttle.chunk) wanted= tgs.throttle.chunk;
+   /* Other threads have to wait while we are sleeping, which is fine as
+    * they would have to sleep anyway. */
+   pthread_mutex_lock_c1(&tgs.throttle.mutex);
+   now= monotonic_ns();
+   if (!throttle_scheduled()) {
+      tgs.throttle.tokens= wanted;
+   } else {
       for (;;) {
-         ssize_t did_read;
-         if ((did_read= read(STDIN_FILENO, in, left)) <= 0) {
-            if (did_read == 0) break;
-            if (did_read != -1) {
-               unlikely_error: ERROR_C1(msg_exotic_error);
-            }
-            /* The write() has failed. Examine why. */
-            switch (errno) {
-               case EFBIG: /* Maximum file/device size reached. */
-                  /* This is considered a "good" reason why the read() has
-                   * failed. */
-                  assert(left > 0);
-                  goto finished;
-               case EINTR: continue; /* Interrupted read(). */
-            }
-            assert(pos >= tgs.start_pos);
-            (void)fprintf(
-                  stderr
-               ,  "Read error at byte offset %" PRIuFAST64 "!\n"
-                  "(Reading did start at byte offset %" PRIuFAST64 ")\n"
-                  "Total bytes read so far: %" PRIuFAST64 "\n"
-               ,  pos, tgs.start_pos, pos - tgs.start_pos
+         if ((elapsed= now - tgs.throttle.updated_ns) > 1000000000u) {
+            elapsed= 1000000000u; /* The bucket will be full anyway. */
+         }
+         tgs.throttle.tokens+= tgs.throttle.rate * elapsed / 1000000000u;
+         if (tgs.throttle.tokens > tgs.throttle.chunk) {
+            tgs.throttle.tokens= tgs.throttle.chunk;
+         }
+         tgs.throttle.updated_ns= now;
+         if (tgs.throttle.tokens >= wanted) break;
+         {
+            struct timespec delay;
+            uint_fast64_t ns= CEIL_DIV(
+                  (wanted - tgs.throttle.tokens) * (uint_fast64_t)1000000000u
+               ,  tgs.throttle.rate
             );
-            ERROR_C1("Read error!");
-         }
-         if ((size_t)did_read > left) goto unlikely_error;
-         in+= (size_t)did_read;
-         pos+= (uint_fast64_t)did_read;
-         left-= (size_t)did_read;
-      }
-      assert(left <= tgs.shared_buffer_size);
-      pos-= left= tgs.shared_buffer_size - left;
-      if (left == 0) break;
-      assert(left >= 1);
-      /* Generate a full buffer of comparison data. */
-      pearnd_generate(reference, tgs.shared_buffer_size, &po);
-      /* Compare buffer contents. */
-      in= tgs.shared_buffer;
-      {
-         size_t i;
-         for (i= 0; i < left; ++i) {
-            if (tgs.mode == mode_diff && in[i] == reference[i]) continue;
-            {
-               char octet[8];
-               unsigned rd= in[i];
-               {
-                  unsigned xor= rd ^ reference[i];
-                  unsigned i, mask= 1;
-                  for (i= 8; i--; mask+= mask) {
-                     octet[i]= xor & mask ? '1' : '0';
-                  }
-                  if (xor) ++differences;
-               }
-               printf_c1(
-                     "%02x %02x %c %8s %" PRIuFAST64 "\n"
-                  ,  (unsigned)reference[i], rd
-                  ,  rd >= 0x20 && rd < 0x7f ? rd : '.'
-                  ,  octet, pos + i
-               );
+            delay.tv_sec= (time_t)(ns / 1000000000u);
+            delay.tv_nsec= (long)(ns % 1000000000u);
+            while (nanosleep(&delay, &delay)) {
+               if (errno != EINTR) ERROR_C1(msg_exotic_error);
             }
          }
+         now= monotonic_ns();
       }
-      pos+= left;
    }
-   finished:
-   assert(pos >= tgs.start_pos);
-   fprintf_c1(
-         stderr
-      ,  "\n"
-         "Comparison complete!\n"
-         "\n"
-         "Reading stopped at byte offset %" PRIuFAST64 "!\n"
-         "(Reading did start at byte offset %" PRIuFAST64 ")\n"
-         "Different bytes encountered: %" PRIuFAST64 "\n"
-         "Total bytes compared: %" PRIuFAST64 "\n"
-      ,  pos, tgs.start_pos, differences, pos - tgs.start_pos
-   );
+   tgs.throttle.tokens-= wanted;
+   tgs.throttle.updated_ns= now;
+   pthread_mutex_unlock_c1(&tgs.throttle.mutex);
+   return wanted;
 }
 
-static char const usage[]=
-   "Usage: %s [ <options> ... ] <mode> <seed_file> [ <starting_offset> ]\n"
-   "\n"
-   "where\n"
-   "\n"
-   "<mode>: One of the following commands\n"
-   "  write - write PRNG stream to standard output at offset\n"
-   "  verify - compare PRNG data against stream from standard input\n"
-   "  compare - Like verify but show every byte ('should' and 'is')\n"
-   "  diff - Like compare but report only differing bytes\n"
-   "<seed_file>: a binary (or text) file up to 256 bytes PRNG seed\n"
-   "<starting_offset>: byte offset where to start writing/verifying\n"
-   "\n"
-   "Standard input or output should be a block device or a file. When\n"
-   "writing to a file, writing stops when there is no more free space\n"
-   "left in the filesystem containing the file, or when the file has\n"
-   "reached the maximum file size supported by the filesystem.\n"
-   "\n"
-   "The <seed_file> determines which pseudo-random sequence of bytes\n"
-   "will be written to or will be expected to be read from the file\n"
-   "or device. The same <seed_file> needs to be used for a 'write'\n"
-   "command and its matching 'verify' command.\n"
-   "\n"
-   "The contents of <seed_file> are arbitrary and should be created\n"
-   "by something like this:\n"
-   "\n"
-   "$ dd if=/dev/random bs=1 count=16 > my_seed_file.bin\n"
-   "\n"
-   "<options>:\n"
-   "\n"
-   "-t <n>: Use <n> CPU threads for write/verify commands instead of\n"
-   "the autodetected number of available processor cores\n"
-   "\n"
-   "-N: Don't be nice. By default, the program will behave as if it\n"
-   "had been invoked via 'nice' and 'ionice -n 6'. With -N, the\n"
-   "program will not do this and keep its initial niceness settings.\n"
-   "\n"
-   "-F: Don't flush the device's cache when reading from a block\n"
-   "device. This makes comparison of small block devices less\n"
-   "reliable, because one never can be sure whether the data read\n"
-   "came actually from the device or rather from the cache. However,\n"
-   "flushing device buffers is a privileged operation, so\n"
-   "unprivileged users can never read from a block device without\n"
-   "this option, even if they are the owner of the device.\n"
-   "\n"
-   "-V: Display version information\n"
-   "\n"
-   "-h: Display this help\n"
-   "\n"
-   "General usage procedure:\n"
-   "\n"
-   "1. Generate a seed file to be used with all following steps\n"
-   "\n"
-   "2. Fill the block device to be tested using the 'write' command\n"
-   "\n"
-   "   'write' can also fill a filesystem, using up all space. This\n"
-   "   allows to check how much uncompressible data can really be\n"
-   "   stored there, and whether the file has actually been written\n"
-   "   correctly (i. e. whether the filesystem works as it should).\n"
-   "\n"
-   "3. Use 'verify' command to check for differences\n"
-   "\n"
-   "   This reads back the data which has been written before and\n"
-   "   checks whether it is still the same. This should be the case\n"
-   "   if everything is fine.\n"
-   "   \n"
-   "   If it is not, 'verify' stops and reports the offset where the\n"
-   "   first different byte was detected.\n"
-   "   \n"
-   "   Differences mean that the storage medium or filesystem either\n"
-   "   does not reliably write data, or it does not reliably read\n"
-   "   data, or it is lying about its supposed storage capacity.\n"
-   "   Either way, such differences are always a bad sign.\n"
-   "   \n"
-   "   To scan for more differences, you can run the 'verify' command\n"
-   "   again, starting at a higher byte offset.\n"
-   "\n"
-   "4. If 'verify' stopped at differences, use 'compare' or 'diff'\n"
-   "   to show them.\n"
-   "\n"
-   "   For every byte offset, 'compare' shows the byte value which\n"
-   "   was expected, the byte value actually read back, the ASCII\n"
-   "   character corresponding to the value read back, and the bit\n"
-   "   differences (XOR) between both bytes.\n"
-   "   \n"
-   "   'diff' does the same, but only writes output lines for bytes\n"
-   "   which actually differ. (It will therefore never display the\n"
-   "   XOR-value '00000000'.)\n"
-   "   \n"
-   "   This means 'diff' does basically the same as 'verify', but it\n"
-   "   is much, much slower. And unlike 'verify', 'diff' will not\n"
-   "   stop comparing when differences have been found.\n"
-   "   \n"
-   "   Therefore, always use 'verify' first to determine where bytes\n"
-   "   start to differ, then use 'diff' or 'compare' to look what\n"
-   "   exactly is different.\n"
-   "   \n"
-   "   'compare' and 'diff' do not stop output by themselves before\n"
-   "   the end of the file/device has been reached. Their output\n"
-   "   should therefore be piped through 'head' or 'more' in order\n"
-   "   to limit the number of lines displayed.\n"
-   "\n"
-   VERSION_INFO "\n"
-;
-
-struct error_reporting_static_resource {
-   r4g_dtor dtor, *saved;
-   char const *argv0;
-};
+/* Prepares throttle_c1() for pacing the I/O in chunks of about 1/16
+ * second, but at least <unit> and at most <max> bytes, where <max> is a
+ * multiple of <unit>. */
+static void init_throttle_c1(size_t unit, size_t max) {
+   uint_fast64_t units;
+   if (tgs.throttle.rate > UINT_FAST64_MAX / 1000000000u) {
+      ERROR_C1("Maximum I/O rate is too large!");
+   }
+   if ((units= tgs.throttle.rate / 16 / unit) > max / unit) units= max / unit;
+   if (!units) units= 1;
+   tgs.throttle.tokens= tgs.throttle.chunk= (size_t)units * unit;
+   tgs.throttle.updated_ns= monotonic_ns();
+}
 
-static void error_reporting_dtor(r4g *rc) {
-   char const *em= 0;
-   R4G_DEFINE_INIT_RPTR( \
-      struct error_reporting_static_resource, *c=, rc, dtor \
-   );
-   rc->rlist= c->saved;
-   if (rc->errors) {
-      if (!(em= rc->static_error_message)) em= msg_exotic_error;
-      if (!*em) em= 0;
+/* Writes a line to the throughput log and remembers the extent as part of
+ * a slow region if applicable. */
+static void finish_extent(void) {
+   uint_fast64_t pos= tgs.tput.pos, bytes= tgs.tput.bytes, ns= tgs.tput.ns;
+   if (!bytes) return;
+   if (!ns) ns= 1;
+   tgs.tput.bytes= tgs.tput.ns= 0;
+   if (tgs.tput.log) {
+      fprintf_c1(
+            tgs.tput.log
+         ,  "%" PRIuFAST64 ",%" PRIuFAST64 ",%" PRIuFAST64 ",%.0f\n"
+         ,  pos, bytes, ns, (double)bytes * 1e9 / ns
+      );
    }
-   if (em) {
-      (void)fprintf(stderr, "%s failed: %s\n", c->argv0, em);
-      clear_error_c1(rc);
+   if ((double)bytes * 1e9 / ns < (double)tgs.tput.min_rate) {
+      struct slow_region *r;
+      if (tgs.tput.slow_regions) {
+         r= &tgs.tput.slow[tgs.tput.slow_regions - 1];
+         if (r->pos + r->bytes == pos) {
+            /* Extend the preceding slow region. */
+            r->bytes+= bytes; r->ns+= ns;
+            return;
+         }
+      }
+      if (tgs.tput.slow_regions == tgs.tput.slow_allocated) {
+         size_t n= tgs.tput.slow_allocated ? tgs.tput.slow_allocated * 2 : 16;
+         if (!(r= realloc(tgs.tput.slow, n * sizeof *r))) {
+            ERROR_C1(msg_malloc_error);
+         }
+         tgs.tput.slow= r; tgs.tput.slow_allocated= n;
+      }
+      r= &tgs.tput.slow[tgs.tput.slow_regions++];
+      r->pos= pos; r->bytes= bytes; r->ns= ns;
    }
 }
 
-struct minimal_resource {
-   r4g_dtor dtor, *saved;
-};
-
-static void resource_context_thread_key_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
-   /* Clear out slot for main thread context because it has not been
-    * allocated dynamically and should therefore not be passed to the
-    * thread key's per-thread slot destructor. */
-   int bad= pthread_setspecific(tgs.resource_context, 0);
-   rc->rlist= r->saved;
-   if (pthread_key_delete(tgs.resource_context) || bad) {
-      error_c1(rc, msg_exotic_error);
+static void record_latency(struct latency_histogram *h, uint_fast64_t ns) {
+   unsigned i;
+   if (ns < 1u << LATENCY_SUB_BITS) {
+      i= (unsigned)ns;
+   } else {
+      unsigned msb= LATENCY_SUB_BITS;
+      while (ns >> msb + 1) ++msb;
+      i= (msb - LATENCY_SUB_BITS << LATENCY_SUB_BITS)
+         + (unsigned)(ns >> msb - LATENCY_SUB_BITS)
+      ;
    }
+   assert(i < DIM(h->count));
+   ++h->count[i];
+   ++h->requests;
+   if (ns > h->max_ns) h->max_ns= ns;
 }
 
-struct pthread_mutex_static_resource {
-   pthread_mutex_t *mutex;
-   r4g_dtor dtor, *saved;
-};
+/* Returns the latency in nanoseconds which is not exceeded by <permille>
+ * parts per thousand of all the requests. */
+static uint_fast64_t latency_percentile(
+   struct latency_histogram const *h, unsigned permille
+) {
+   uint_fast64_t wanted= CEIL_DIV(h->requests * permille, 1000), seen= 0;
+   unsigned i;
+   for (i= 0; i < DIM(h->count); ++i) {
+      if ((seen+= h->count[i]) && seen >= wanted) {
+         /* Use the upper limit of the bucket. */
+         uint_fast64_t limit;
+         unsigned e= i >> LATENCY_SUB_BITS;
+         limit= e ? (uint_fast64_t)(i & (1u << LATENCY_SUB_BITS) - 1) + 1
+               + (1u << LATENCY_SUB_BITS) << e - 1
+            :  i + 1
+         ;
+         --limit;
+         return limit < h->max_ns ? limit : h->max_ns;
+      }
+   }
+   return h->max_ns;
+}
 
-static void pthread_mutex_static_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct pthread_mutex_static_resource, *r=, rc, dtor);
-   rc->rlist= r->saved;
-   if (pthread_mutex_destroy(r->mutex)) ERROR_C1(msg_exotic_error);
+static void report_latencies(struct latency_histogram const *h) {
+   fprintf_c1(
+         stderr
+      ,  "latency p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms"
+      ,  latency_percentile(h, 500) / 1e6, latency_percentile(h, 990) / 1e6
+      ,  latency_percentile(h, 999) / 1e6, h->max_ns / 1e6
+   );
 }
 
-struct pthread_cond_static_resource {
-   pthread_cond_t *cond;
-   r4g_dtor dtor, *saved;
-};
+/* Warns about an I/O request which took longer than -S permits. */
+static void warn_about_stalls(
+   uint_fast64_t pos, size_t bytes, uint_fast64_t ns
+) {
+   if (tgs.stall_ns && ns > tgs.stall_ns) {
+      fprintf_c1(
+            stderr
+         ,  "Warning: I/O request for %zu bytes at byte offset %" PRIuFAST64
+            " took %.3f seconds!\n"
+         ,  bytes, pos, ns / 1e9
+      );
+   }
+}
 
-static void pthread_cond_static_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct pthread_cond_static_resource, *r=, rc, dtor);
-   rc->rlist= r->saved;
-   if (pthread_cond_destroy(r->cond)) ERROR_C1(msg_exotic_error);
+/* Adds the latencies counted in <src> to those in <dst>. */
+static void merge_latencies(
+   struct latency_histogram *dst, struct latency_histogram const *src
+) {
+   unsigned i;
+   for (i= (unsigned)DIM(dst->count); i--; ) dst->count[i]+= src->count[i];
+   dst->requests+= src->requests;
+   if (src->max_ns > dst->max_ns) dst->max_ns= src->max_ns;
 }
 
-static void shared_buffers_dtor(r4g *rc) {
-   {
-      unsigned i;
-      for (i= (unsigned)DIM(tgs.shared_buffers); i--; ) {
-         if (tgs.shared_buffers[i]) {
-            void *old= tgs.shared_buffers[i]; tgs.shared_buffers[i]= 0;
-            if (munmap(old, tgs.shared_buffer_size)) {
-               error_c1(rc, msg_exotic_error);
-            }
-         }
+/* Account for <bytes> just transferred at byte offset <pos> by a single I/O
+ * request which took <ns> nanoseconds. The time is distributed
+ * proportionally if the request spans more than one extent. */
+static void record_io(uint_fast64_t pos, size_t bytes, uint_fast64_t ns) {
+   uint_fast64_t const extent= tgs.tput.extent;
+   record_latency(&tgs.latency, ns);
+   warn_about_stalls(pos, bytes, ns);
+   if (tgs.progress.interval_ns) {
+      uint_fast64_t now= monotonic_ns();
+      tgs.progress.bytes+= bytes;
+      if (now - tgs.progress.last_ns >= tgs.progress.interval_ns) {
+         fprintf_c1(
+               stderr
+            ,  "At byte offset %" PRIuFAST64 ", %.0f bytes per second, "
+            ,  pos + bytes
+            ,  tgs.progress.bytes * 1e9 / (now - tgs.progress.last_ns)
+         );
+         report_latencies(&tgs.latency);
+         fprintf_c1(stderr, "\n");
+         tgs.progress.last_ns= now; tgs.progress.bytes= 0;
       }
    }
+   if (!extent) return;
+   while (bytes) {
+      uint_fast64_t end= pos - pos % extent + extent, part, part_ns;
+      if ((part= end - pos) > bytes) part= bytes;
+      part_ns= part == bytes ? ns : ns * part / bytes;
+      if (!tgs.tput.bytes) tgs.tput.pos= pos;
+      tgs.tput.bytes+= part; tgs.tput.ns+= part_ns;
+      pos+= part; bytes-= (size_t)part; ns-= part_ns;
+      if (pos == end) finish_extent();
+   }
+}
+
+/* Reports the hardware events counted by -H per processed byte. */
+static void report_perf_counters(void) {
+   static char const *const phases[PERF_PHASES]= {0, "I/O"};
+   unsigned i;
+   fprintf_c1(
+         stderr
+      ,  "Hardware performance counters (%s) of %u threads:\n"
+      ,  tgs.perf.exclude_kernel ? "user space only" : "user and kernel space"
+      ,  tgs.perf.threads
+   );
+   if (tgs.perf.failed) {
+      fprintf_c1(
+            stderr, "  (could not be opened for another %u threads)\n"
+         ,  tgs.perf.failed
+      );
+   }
+   for (i= 0; i < PERF_PHASES; ++i) {
+      uint_fast64_t const *c= tgs.perf.counts[i];
+      double const bytes= (double)tgs.perf.bytes[i];
+      if (!tgs.perf.bytes[i] || !c[perf_cycles]) continue;
+      fprintf_c1(
+            stderr
+         ,  "  %s: %.3f cycles per byte, %.2f instructions per cycle,"
+            " %.1f cache misses and %.1f branch misses per MiB\n"
+         ,  phases[i] ? phases[i]
+            : tgs.mode == mode_write ? "generating" : "processing"
+         ,  (double)c[perf_cycles] / bytes
+         ,  (double)c[perf_instructions] / (double)c[perf_cycles]
+         ,  (double)c[perf_cache_misses] * (1 << 20) / bytes
+         ,  (double)c[perf_branch_misses] * (1 << 20) / bytes
+      );
+   }
+}
+
+/* Complete the throughput measurements and display the request latencies
+ * and slow regions. */
+static void report_io_statistics(void) {
+   finish_extent();
+   if (tgs.salvage.map) {
+      fprintf_c1(
+            stderr
+         ,  "Unreadable bytes skipped: %" PRIuFAST64
+            " in %" PRIuFAST64 " extents\n"
+         ,  tgs.salvage.total, tgs.salvage.extents
+      );
+   }
+   fprintf_c1(
+      stderr, "I/O requests: %" PRIuFAST64 ", ", tgs.latency.requests
+   );
+   report_latencies(&tgs.latency);
+   fprintf_c1(stderr, "\n");
+   if (tgs.perf.enabled) report_perf_counters();
+   if (!tgs.tput.min_rate) return;
+   fprintf_c1(
+         stderr
+      ,  "Regions slower than %" PRIuFAST64 " bytes per second: %zu\n"
+      ,  tgs.tput.min_rate, tgs.tput.slow_regions
+   );
    {
-      R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
-      rc->rlist= r->saved;
+      size_t i;
+      for (i= 0; i < tgs.tput.slow_regions; ++i) {
+         struct slow_region const *r= &tgs.tput.slow[i];
+         fprintf_c1(
+               stderr
+            ,  "  byte offset %" PRIuFAST64 " through %" PRIuFAST64
+               ": %.0f bytes per second\n"
+            ,  r->pos, r->pos + r->bytes - 1, (double)r->bytes * 1e9 / r->ns
+         );
+      }
    }
 }
 
-struct cancel_threads_static_resource {
-   unsigned threads;
-   pthread_t *tid;
-   char *tvalid;
-   r4g_dtor dtor, *saved;
+/* Size of the units of the data stream whose ends are made compressible
+ * by -C. Matches the page size of typical flash translation layers. */
+#define COMPRESSIBLE_UNIT 4096
+
+/* Fixed test patterns for -p, except for the single byte patterns
+ * "0x<hh>" which are not listed. */
+static struct {
+   char const *name;
+   pattern kind;
+} const pattern_kinds[]= {
+      {"zeros", {0, 0}}
+   ,  {"ones", {UINT64_C(0xffffffffffffffff), 0}}
+   ,  {"walking-ones", {UINT64_C(0x8040201008040201), 0}}
+   ,  {"walking-zeros", {UINT64_C(0x7fbfdfeff7fbfdfe), 0}}
+   ,  {"address", {0, 1}}
 };
 
-static void cancel_threads_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct cancel_threads_static_resource, *r=, rc, dtor);
-   {
-      unsigned i;
-      for (i= r->threads; i--; ) {
-         if (r->tvalid[i]) {
-            r->tvalid[i]= 0;
-            if (rc->errors) {
-               if (pthread_cancel(r->tid[i])) {
-                  error_c1(rc, "Could not terminate child thread!");
-               }
-            }
-            {
-               void *thread_error;
-               if (pthread_join(r->tid[i], &thread_error)) {
-                  error_c1(
-                     rc, "Failure waiting for child thread to terminate!"
-                  );
-               }
-               if (thread_error && thread_error != PTHREAD_CANCELED) {
-                  error_c1(rc, thread_error);
-               }
-            }
+/* Fills <dst> with the <count> bytes of the data stream at byte offset
+ * <pos>, without the sector headers of -T. This is the fixed pattern
+ * selected by -p if any, or otherwise the PRNG stream, except for the last
+ * tgs.compressible bytes of every COMPRESSIBLE_UNIT when -C is used. Those
+ * bytes repeat the offset of their unit as a 64 bit little endian word.
+ * Compressors reduce this to almost nothing, but it is not zero like
+ * unused space. */
+static void generate_stream(
+   uint8_t *dst, size_t count, uint_fast64_t pos
+) {
+   pearnd_offset po;
+   if (tgs.pattern.enabled) {
+      pattern_generate(dst, count, pos, &tgs.pattern.kind);
+      return;
+   }
+   if (!tgs.compressible) {
+      pearnd_seek(&po, pos);
+      pearnd_generate(dst, count, &po);
+      return;
+   }
+   while (count) {
+      uint_fast64_t const unit= pos - pos % COMPRESSIBLE_UNIT;
+      size_t const random= COMPRESSIBLE_UNIT - tgs.compressible;
+      size_t n= (size_t)(unit + COMPRESSIBLE_UNIT - pos);
+      if (n > count) n= count;
+      count-= n;
+      if (pos - unit < random) {
+         size_t r= random - (size_t)(pos - unit);
+         if (r > n) r= n;
+         pearnd_seek(&po, pos);
+         pearnd_generate(dst, r, &po);
+         dst+= r; pos+= r; n-= r;
+      }
+      for (; n; --n, ++pos) *dst++= (uint8_t)(unit >> 8 * (unsigned)(pos % 8));
+   }
+}
+
+/* XORs <dst> with generate_stream() output for the same arguments.
+ * Returns nonzero if any resulting byte is not zero. */
+static int xor_stream(uint8_t *dst, size_t count, uint_fast64_t pos) {
+   pearnd_offset po;
+   int differences= 0;
+   if (tgs.pattern.enabled) {
+      return pattern_xor(dst, count, pos, &tgs.pattern.kind);
+   }
+   if (!tgs.compressible) {
+      pearnd_seek(&po, pos);
+      return pearnd_xor(dst, count, &po);
+   }
+   while (count) {
+      uint_fast64_t const unit= pos - pos % COMPRESSIBLE_UNIT;
+      size_t const random= COMPRESSIBLE_UNIT - tgs.compressible;
+      size_t n= (size_t)(unit + COMPRESSIBLE_UNIT - pos);
+      if (n > count) n= count;
+      count-= n;
+      if (pos - unit < random) {
+         size_t r= random - (size_t)(pos - unit);
+         if (r > n) r= n;
+         pearnd_seek(&po, pos);
+         if (pearnd_xor(dst, r, &po)) differences= 1;
+         dst+= r; pos+= r; n-= r;
+      }
+      for (; n; --n, ++pos) {
+         if (*dst++^= (uint8_t)(unit >> 8 * (unsigned)(pos % 8))) {
+            differences= 1;
          }
       }
    }
-   rc->rlist= r->saved;
+   return differences;
 }
 
-struct mallocated_resource {
-   void *buffer;
-   r4g_dtor dtor, *saved;
-};
+/* Returns the byte of the -T sector header which belongs at byte offset
+ * <pos>, which must be within the first STAMP_HEADER_SIZE bytes of its
+ * sector. */
+static uint8_t stamp_byte(uint_fast64_t pos) {
+   unsigned const i= (unsigned)(pos % STAMP_SECTOR_SIZE);
+   uint_fast64_t const word= i < 8 ? pos - i : tgs.stamps.fingerprint;
+   return (uint8_t)(word >> 8 * (i % 8));
+}
 
-static void mallocated_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct mallocated_resource, *r=, rc, dtor);
-   void *buffer= r->buffer;
-   rc->rlist= r->saved;
-   free(r);
-   free(buffer);
+/* Fills <dst> with the <count> bytes of the data stream at byte offset
+ * <pos>, including the sector headers if -T is used. */
+static void generate_data(uint8_t *dst, size_t count, uint_fast64_t pos) {
+   uint_fast64_t const end= pos + count;
+   uint_fast64_t sector;
+   generate_stream(dst, count, pos);
+   if (!tgs.stamps.enabled) return;
+   for (
+      sector= pos - pos % STAMP_SECTOR_SIZE; sector < end
+      ; sector+= STAMP_SECTOR_SIZE
+   ) {
+      uint_fast64_t p= sector < pos ? pos : sector;
+      for (; p < sector + STAMP_HEADER_SIZE && p < end; ++p) {
+         dst[p - pos]= stamp_byte(p);
+      }
+   }
+}
+
+/* XORs <dst> with generate_data() output for the same arguments. Returns
+ * nonzero if any resulting byte is not zero. */
+static int xor_data(uint8_t *dst, size_t count, uint_fast64_t pos) {
+   int differences= 0;
+   if (!tgs.stamps.enabled) return xor_stream(dst, count, pos);
+   while (count) {
+      size_t const i= (size_t)(pos % STAMP_SECTOR_SIZE);
+      size_t n= (i < STAMP_HEADER_SIZE ? STAMP_HEADER_SIZE : STAMP_SECTOR_SIZE)
+         - i
+      ;
+      if (n > count) n= count;
+      count-= n;
+      if (i < STAMP_HEADER_SIZE) {
+         for (; n; --n, ++pos) if (*dst++^= stamp_byte(pos)) differences= 1;
+      } else {
+         if (xor_stream(dst, n, pos)) differences= 1;
+         dst+= n; pos+= n;
+      }
+   }
+   return differences;
+}
+
+/* Expected data which cannot be compared on the fly is generated in pieces
+ * of this size, small enough to stay in the L1 cache. */
+#define COMPARE_PIECE_SIZE 4096
+
+/* Returns the index of the first of the <count> bytes at <data> which
+ * differs from generate_data() output for the same <pos>, or <count> if
+ * all of them match. The PRNG stream is compared without storing it. */
+static size_t compare_data(
+   uint8_t const *data, size_t count, uint_fast64_t pos
+) {
+   uint8_t expected[COMPARE_PIECE_SIZE];
+   size_t done;
+   if (!tgs.pattern.enabled && !tgs.compressible && !tgs.stamps.enabled) {
+      pearnd_offset po;
+      pearnd_seek(&po, pos);
+      return pearnd_compare(data, count, &po);
+   }
+   for (done= 0; done < count; ) {
+      size_t n= count - done;
+      if (n > sizeof expected) n= sizeof expected;
+      generate_data(expected, n, pos + done);
+      if (memcmp(data + done, expected, n)) {
+         size_t i;
+         for (i= 0; data[done + i] == expected[i]; ++i) {}
+         return done + i;
+      }
+      done+= n;
+   }
+   return count;
+}
+
+static void *writer_thread(void *unused_dummy) {
+   r4g *rc;
+   int *workers_mutex_procured;
+   struct perf_resource *perf;
+   size_t const segments= tgs.work_segments * DIM(tgs.shared_buffers);
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   workers_mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
+   assert(!*workers_mutex_procured);
+   perf= perf_counters_c5();
+   /* Lock the mutex before acessing the global work state variables. */
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   *workers_mutex_procured= 1;
+   /* Thread main loop. */
+   for (;;) {
+      uint_fast64_t const oldest= tgs.pipeline.written;
+      assert(*workers_mutex_procured);
+      if (tgs.shutdown_requested) break;
+      if (
+            !tgs.pipeline.writing && oldest < tgs.pipeline.claimed
+         && tgs.pipeline.ready[oldest % segments]
+      ) {
+         /* The oldest segment not written yet is ready. Write it together
+          * with any ready segments following it in the same buffer, while
+          * the other threads go on generating and refill the ring as soon
+          * as we are done. */
+         size_t const first= (size_t)(oldest % segments);
+         size_t n= 1, left;
+         uint8_t const *out;
+         uint_fast64_t pos, io_started;
+         while (
+               (first + n) % tgs.work_segments
+            && oldest + n < tgs.pipeline.claimed
+            && tgs.pipeline.ready[first + n]
+         ) {
+            ++n;
+         }
+         out=
+               tgs.shared_buffers[first / tgs.work_segments]
+            +  first % tgs.work_segments * tgs.work_segment_sz
+         ;
+         left= n * tgs.work_segment_sz;
+         pos= tgs.start_pos + oldest * tgs.work_segment_sz;
+         /* Starting to write another buffer is what used to be a buffer
+          * switch. */
+         if (tgs.adaptive && !(first % tgs.work_segments)) {
+            adapt_busy_workers();
+         }
+         tgs.pipeline.writing= 1;
+         assert(*workers_mutex_procured);
+         *workers_mutex_procured= 0;
+         pthread_mutex_unlock_c1(&tgs.workers_mutex);
+         io_started= monotonic_ns();
+         perf_begin(perf);
+         for (; left; ) {
+            ssize_t written;
+            uint_fast64_t started;
+            {
+               size_t chunk= throttle_c1(left);
+               started= monotonic_ns();
+               written= write(STDOUT_FILENO, out, chunk);
+            }
+            if (written <= 0) {
+               if (written == 0) break;
+               if (written != -1) {
+                  unlikely_error: ERROR_C1(msg_exotic_error);
+               }
+               /* The write() has failed. Examine why. */
+               switch (errno) {
+                  case ENOSPC: /* We filled up the filesystem. */
+                  case EPIPE: /* Output stream has ended. */
+                  case EDQUOT: /* Quota has been reached. */
+                  case EFBIG: /* Maximum file/device size reached. */
+                     /* Those are all considered "good" reasons why the
+                      * write() has failed. */
+                     assert(left > 0);
+                     goto finished;
+                  case EINTR: continue; /* Interrupted write(). */
+               }
+               assert(pos >= tgs.start_pos);
+               (void)fprintf(
+                     stderr
+                  ,  "Write error at byte offset %" PRIuFAST64 "!\n"
+                     "(Output did start at byte offset %" PRIuFAST64 ")\n"
+                     "Total bytes written so far: %" PRIuFAST64 "\n"
+                  ,  pos, tgs.start_pos, pos - tgs.start_pos
+               );
+               error_c1(rc, msg_write_error);
+            }
+            if ((size_t)written > left) goto unlikely_error;
+            record_io(pos, (size_t)written, monotonic_ns() - started);
+            out+= (size_t)written;
+            pos+= (uint_fast64_t)written;
+            left-= (size_t)written;
+            if (tgs.writeback.limit) control_writeback(pos, 0);
+         }
+         finished:
+         io_started= monotonic_ns() - io_started;
+         perf_end(perf, perf_io, n * tgs.work_segment_sz - left);
+         assert(!*workers_mutex_procured);
+         pthread_mutex_lock_c1(&tgs.workers_mutex);
+         *workers_mutex_procured= 1;
+         tgs.pipeline.io_ns+= io_started;
+         if (left) {
+            /* Output data sink does not accept any more data - we are
+             * done. Try to write some statistics to standard error. */
+            assert(pos >= tgs.start_pos);
+            if (tgs.writeback.limit) control_writeback(pos, 1);
+            fprintf_c1(
+                  stderr
+               ,  "\n"
+                  "Success!\n"
+                  "\n"
+                  "Output stopped at byte offset %" PRIuFAST64 "!\n"
+                  "(Output did start at byte offset %" PRIuFAST64 ")\n"
+                  "Total bytes written: %" PRIuFAST64 "\n"
+               ,  pos, tgs.start_pos, pos - tgs.start_pos
+            );
+            report_io_statistics();
+            if (tgs.adaptive) {
+               fprintf_c1(
+                     stderr
+                  ,  "PRNG worker threads finally kept busy: %u of %u\n"
+                  ,  tgs.max_busy_workers, tgs.threads
+               );
+            }
+            /* Initiate successful termination. */
+            tgs.shutdown_requested= 1;
+            /* Make sure any sleeping threads will wake up to learn
+             * about the shutdown request. */
+            pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+            pthread_cond_broadcast_c1(&tgs.workers_parking_lot);
+            break;
+         }
+         /* Hand the segments back for generating more data. */
+         for (; n--; ++tgs.pipeline.written) {
+            tgs.pipeline.ready[tgs.pipeline.written % segments]= 0;
+         }
+         if (!(tgs.pipeline.written % tgs.work_segments)) {
+            /* A whole buffer has been written. */
+            tgs.io_ns= tgs.pipeline.io_ns;
+            tgs.pipeline.io_ns= 0;
+         }
+         tgs.pipeline.writing= 0;
+         pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+      } else if (tgs.pipeline.claimed - oldest == segments) {
+         /* All segments are either being generated or waiting for being
+          * written. Wait until some have been written. */
+         assert(*workers_mutex_procured);
+         *workers_mutex_procured= 0;
+         /* Unlock mutex, wait for a broadcast, then lock mutex again. */
+         pthread_cond_wait_c1(&tgs.workers_wakeup_call, &tgs.workers_mutex);
+         *workers_mutex_procured= 1;
+      } else if (tgs.busy_workers >= tgs.max_busy_workers) {
+         /* There is more work to do, but enough other threads are already
+          * working on it in order to keep up with the output. Park this
+          * thread until adapt_busy_workers() finds it is needed again. */
+         ++tgs.parked_threads;
+         assert(*workers_mutex_procured);
+         *workers_mutex_procured= 0;
+         pthread_cond_wait_c1(&tgs.workers_parking_lot, &tgs.workers_mutex);
+         *workers_mutex_procured= 1;
+         --tgs.parked_threads;
+      } else {
+         /* There is more work to do. Seize the next work segment. */
+         uint_fast64_t const index= tgs.pipeline.claimed++;
+         size_t const slot= (size_t)(index % segments);
+         uint8_t *const work_segment=
+               tgs.shared_buffers[slot / tgs.work_segments]
+            +  slot % tgs.work_segments * tgs.work_segment_sz
+         ;
+         uint_fast64_t const pos= tgs.pos;
+         tgs.pos+= tgs.work_segment_sz;
+         ++tgs.busy_workers;
+         /* Allow other threads to seize work segments as well. */
+         *workers_mutex_procured= 0;
+         pthread_mutex_unlock_c1(&tgs.workers_mutex);
+         /* Do every worker thread's primary job: Process its work
+          * segment. */
+         perf_begin(perf);
+         if (tgs.nt_stores) {
+            /* Only the kernel will read the data again, so keep it out of
+             * the caches. The stores are fenced before the segment is
+             * marked as ready. */
+            pearnd_offset po;
+            pearnd_seek(&po, pos);
+            pearnd_generate_nt(work_segment, tgs.work_segment_sz, &po);
+         } else {
+            generate_data(work_segment, tgs.work_segment_sz, pos);
+         }
+         perf_end(perf, perf_processing, tgs.work_segment_sz);
+         /* Mark the segment as ready, and see whether we can write it or
+          * get the next job. */
+         pthread_mutex_lock_c1(&tgs.workers_mutex);
+         *workers_mutex_procured= 1;
+         --tgs.busy_workers;
+         tgs.pipeline.ready[slot]= 1;
+         {
+            /* Find out whether the buffer containing the segment is
+             * complete now. Some of its segments may already have been
+             * written, so the <ready> flags cannot tell. */
+            size_t *const generated= &tgs.pipeline.generated[
+               index / tgs.work_segments % DIM(tgs.pipeline.generated)
+            ];
+            if (++*generated == tgs.work_segments) {
+               *generated= 0;
+               tgs.generated_ns= monotonic_ns();
+            }
+         }
+      }
+   }
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+              
+static uint_fast64_t atou64(char const *numeric) {
+   uint_fast64_t result;
+   int converted;
+   if (
+         sscanf(numeric, "%" SCNuFAST64 "%n", &result, &converted) != 1
+      || (size_t)converted != strlen(numeric)
+   ) {
+      ERROR_C1("Invalid number!");
+   }
+   return result;
+}
+
+/* Like atou64(), but also accepts an optional suffix "k", "M", "G" or "T"
+ * (in either letter case) which multiplies the number by the corresponding
+ * power of 1024. */
+static uint_fast64_t atou64_scaled(char const *numeric) {
+   uint_fast64_t result;
+   int converted;
+   unsigned shift= 0;
+   if (sscanf(numeric, "%" SCNuFAST64 "%n", &result, &converted) != 1) {
+      invalid: ERROR_C1("Invalid number!");
+   }
+   switch (numeric[converted]) {
+      case '\0': break;
+      case 'T': case 't': shift+= 10; /* Fall through. */
+      case 'G': case 'g': shift+= 10; /* Fall through. */
+      case 'M': case 'm': shift+= 10; /* Fall through. */
+      case 'K': case 'k': shift+= 10;
+         if (numeric[++converted]) goto invalid;
+         break;
+      default: goto invalid;
+   }
+   if (result << shift >> shift != result) ERROR_C1("Number too large!");
+   return result << shift;
+}
+
+/* Parses a comma-separated list of at most <max> numbers with optional
+ * suffixes into <values> and returns the number of values. */
+static unsigned parse_list_c1(
+   uint_fast64_t *values, unsigned max, char const *list
+) {
+   unsigned n= 0;
+   for (;;) {
+      char item[32];
+      size_t len= strcspn(list, ",");
+      if (n == max || len >= sizeof item) ERROR_C1("Invalid list!");
+      (void)memcpy(item, list, len); item[len]= '\0';
+      if (!(values[n++]= atou64_scaled(item))) ERROR_C1("Invalid list!");
+      if (!list[len]) return n;
+      list+= len + 1;
+   }
+}
+
+struct FILE_mallocated_resource {
+   FILE *handle;
+   r4g_dtor dtor, *saved;
+};
+
+static void FILE_mallocated_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct FILE_mallocated_resource, *r=, rc, dtor);
+   FILE *fh= r->handle;
+   rc->rlist= r->saved;
+   free(r);
+   if (fh && fclose(fh)) error_c1(rc, "Error while closing file!");
+}
+
+static void load_seed(char const *seed_file) {
+   struct FILE_mallocated_resource *f= malloc_c1(sizeof *f);
+   FILE *fh;
+   r4g *rc;
+   r4g_dtor *marker;
+   f->saved= marker= (rc= r4g_c1())->rlist; f->dtor= &FILE_mallocated_dtor;
+   rc->rlist= &f->dtor;
+   if (!(f->handle= fh= fopen(seed_file, "rb"))) {
+      rd_err: error_c1(rc, "Cannot read seed file!");
+   }
+   {
+      #define MAX_SEED_BYTES 256
+      char seed[MAX_SEED_BYTES + 1]; /* 1 byte larger than actually allowed. */
+      #undef MAX_SEED_BYTES
+      size_t read;
+      if ((read= fread(seed, sizeof *seed, DIM(seed), fh)) == DIM(seed)) {
+         error_c1(
+            rc, "Key file for seeding the PRNG is larger than supported!"
+         );
+      }
+      if (ferror(fh)) goto rd_err;
+      assert(feof(fh));
+      if (!read) error_c1(rc, "Seed file must not be empty!");
+      pearnd_init(seed, read);
+      /* Zero would make sectors which are zero look like stamped ones. */
+      if (!(tgs.stamps.fingerprint= xxh64(seed, read, 0))) {
+         tgs.stamps.fingerprint= 1;
+      }
+   }
+   release_to_c1(rc, marker);
+}
+
+/* Upper limit for the exponentially growing distance skipped ahead after
+ * consecutive unreadable sectors. */
+#define SALVAGE_MAX_SKIP (UINT64_C(1) << 30)
+
+static void log_unreadable_extent(void) {
+   if (!tgs.salvage.bytes) return;
+   fprintf_c1(
+         tgs.salvage.map, "%" PRIuFAST64 ",%" PRIuFAST64 "\n"
+      ,  tgs.salvage.pos, tgs.salvage.bytes
+   );
+   tgs.salvage.bytes= 0;
+}
+
+/* Marks <bytes> at byte offset <pos> as unreadable and fills the
+ * respective part of <buffer> with the expected data, so that the
+ * unreadable data will not be counted as differences. */
+static void unreadable(uint8_t *buffer, size_t bytes, uint_fast64_t pos) {
+   if (
+         tgs.salvage.bytes
+      && tgs.salvage.pos + tgs.salvage.bytes == pos
+   ) {
+      tgs.salvage.bytes+= bytes;
+   } else {
+      log_unreadable_extent();
+      ++tgs.salvage.extents;
+      tgs.salvage.pos= pos; tgs.salvage.bytes= bytes;
+   }
+   tgs.salvage.total+= bytes;
+   generate_data(buffer, bytes, pos);
+   if (tgs.salvage.mask) {
+      memset(tgs.salvage.mask + (buffer - tgs.shared_buffer), 1, bytes);
+   }
+}
+
+/* Reads <size> bytes at byte offset <pos> from standard input into
+ * <buffer>, after a normal read() has failed with EIO somewhere in this
+ * range. The failing range is repeatedly split in half until the
+ * unreadable sectors have been isolated. Once a bad sector has been found,
+ * the distance skipped ahead without even trying to read doubles with
+ * every further bad sector, until something can be read again. This keeps
+ * the number of (slow) failing read attempts within dense bad areas
+ * small. Returns the number of bytes processed, which is only less than
+ * <size> at the end of the input. */
+static size_t salvage_c1(uint8_t *buffer, size_t size, uint_fast64_t pos) {
+   size_t done= 0;
+   while (done < size) {
+      size_t piece= size - done;
+      if (pos < tgs.salvage.skip_until) {
+         if (tgs.salvage.skip_until - pos < piece) {
+            piece= (size_t)(tgs.salvage.skip_until - pos);
+         }
+         unreadable(buffer, piece, pos);
+      } else {
+         /* Within a bad area, probe a single sector first. */
+         if (tgs.salvage.skip && piece > tgs.salvage.sector) {
+            piece= tgs.salvage.sector;
+         }
+         for (;;) {
+            ssize_t did_read;
+            if (
+               (did_read= pread(STDIN_FILENO, buffer, piece, (off_t)pos)) > 0
+            ) {
+               piece= (size_t)did_read;
+               tgs.salvage.skip= 0;
+               break;
+            }
+            if (did_read == 0) return done;
+            switch (errno) {
+               case EINTR: continue;
+               case EIO: break;
+               default: ERROR_C1("Read error!");
+            }
+            if (piece > tgs.salvage.sector) {
+               /* Try the first half. The second half will be attempted
+                * afterwards by the outer loop. */
+               piece= CEIL_DIV(piece / 2, tgs.salvage.sector)
+                  * tgs.salvage.sector
+               ;
+               continue;
+            }
+            (void)fprintf(
+                  stderr
+               ,  "Unreadable sector at byte offset %" PRIuFAST64 "!\n"
+               ,  pos
+            );
+            unreadable(buffer, piece, pos);
+            tgs.salvage.skip_until= pos + piece + tgs.salvage.skip;
+            if (tgs.salvage.skip_until > tgs.salvage.end) {
+               tgs.salvage.skip_until= tgs.salvage.end;
+            }
+            tgs.salvage.skip= !tgs.salvage.skip
+               ?  tgs.salvage.sector
+               :  tgs.salvage.skip < SALVAGE_MAX_SKIP
+               ?  tgs.salvage.skip * 2
+               :  SALVAGE_MAX_SKIP
+            ;
+            break;
+         }
+      }
+      buffer+= piece; pos+= piece; done+= piece;
+   }
+   return done;
+}
+
+/* Reads up to <size> bytes from standard input into <buffer>, which
+ * start at byte offset <pos>. Returns the number of bytes read, which is
+ * only less than <size> at the end of the input. */
+static size_t read_input_c1(uint8_t *buffer, size_t size, uint_fast64_t pos) {
+   size_t left= size;
+   while (left) {
+      ssize_t did_read;
+      uint_fast64_t started;
+      {
+         size_t chunk= throttle_c1(left);
+         started= monotonic_ns();
+         if (
+               pos < tgs.salvage.skip_until
+            || (did_read= read(STDIN_FILENO, buffer, chunk)) == -1
+               && errno == EIO && tgs.salvage.map
+         ) {
+            /* (Re-)read the range, but tolerate errors. */
+            did_read= (ssize_t)salvage_c1(buffer, chunk, pos);
+            if (
+               lseek(
+                     STDIN_FILENO, (off_t)(pos + (size_t)did_read)
+                  ,  SEEK_SET
+               ) == (off_t)-1
+            ) {
+               goto unlikely_error;
+            }
+         }
+      }
+      if (did_read <= 0) {
+         if (did_read == 0) break;
+         if (did_read != -1) {
+            unlikely_error: ERROR_C1(msg_exotic_error);
+         }
+         /* The read() has failed. Examine why. */
+         switch (errno) {
+            /* Maximum file/device size reached. This is considered a
+             * "good" reason why the read() has failed. */
+            case EFBIG: return size - left;
+            case EINTR: continue; /* Interrupted read(). */
+         }
+         assert(pos >= tgs.start_pos);
+         (void)fprintf(
+               stderr
+            ,  "Read error at byte offset %" PRIuFAST64 "!\n"
+               "(Reading did start at byte offset %" PRIuFAST64 ")\n"
+               "Total bytes read so far: %" PRIuFAST64 "\n"
+            ,  pos, tgs.start_pos, pos - tgs.start_pos
+         );
+         ERROR_C1("Read error!");
+      }
+      if ((size_t)did_read > left) goto unlikely_error;
+      record_io(pos, (size_t)did_read, monotonic_ns() - started);
+      buffer+= (size_t)did_read;
+      pos+= (uint_fast64_t)did_read;
+      left-= (size_t)did_read;
+   }
+   return size - left;
+}
+
+static void slow_comparison(void) {
+   uint_fast64_t differences= 0;
+   uint_fast64_t pos= tgs.pos;
+   uint8_t reference[COMPARE_PIECE_SIZE];
+   /* Write a header. */
+   fprintf_c1(stderr, "\nEX RD A %-8s BYTE OFFSET\n", "XOR");
+   for (;;) {
+      uint8_t *in= tgs.shared_buffer;
+      size_t left, done= 0;
+      /* Read the next buffer full of input data. */
+      if (tgs.salvage.mask) {
+         memset(tgs.salvage.mask, 0, tgs.shared_buffer_size);
+      }
+      if (!(left= read_input_c1(in, tgs.shared_buffer_size, pos))) break;
+      while (done < left) {
+         size_t n;
+         if (tgs.mode == mode_diff) {
+            /* Skip matching data without generating it into memory. */
+            if ((done+= compare_data(in + done, left - done, pos + done))
+               == left
+            ) {
+               break;
+            }
+         }
+         /* Generate the comparison data for the next piece. */
+         if ((n= left - done) > sizeof reference) n= sizeof reference;
+         generate_data(reference, n, pos + done);
+         /* Compare piece contents. */
+         {
+            size_t i;
+            for (i= 0; i < n; ++i) {
+               if (tgs.mode == mode_diff && in[done + i] == reference[i]) {
+                  continue;
+               }
+               if (tgs.salvage.mask && tgs.salvage.mask[done + i]) {
+                  /* There is nothing to show for unreadable bytes. */
+                  printf_c1(
+                        "%02x ?? ? ???????? %" PRIuFAST64 "\n"
+                     ,  (unsigned)reference[i], pos + done + i
+                  );
+                  continue;
+               }
+               {
+                  char octet[8];
+                  unsigned rd= in[done + i];
+                  {
+                     unsigned xor= rd ^ reference[i];
+                     unsigned i, mask= 1;
+                     for (i= 8; i--; mask+= mask) {
+                        octet[i]= xor & mask ? '1' : '0';
+                     }
+                     if (xor) ++differences;
+                  }
+                  printf_c1(
+                        "%02x %02x %c %.8s %" PRIuFAST64 "\n"
+                     ,  (unsigned)reference[i], rd
+                     ,  rd >= 0x20 && rd < 0x7f ? rd : '.'
+                     ,  octet, pos + done + i
+                  );
+               }
+            }
+         }
+         done+= n;
+      }
+      pos+= left;
+   }
+   assert(pos >= tgs.start_pos);
+   fprintf_c1(
+         stderr
+      ,  "\n"
+         "Comparison complete!\n"
+         "\n"
+         "Reading stopped at byte offset %" PRIuFAST64 "!\n"
+         "(Reading did start at byte offset %" PRIuFAST64 ")\n"
+         "Different bytes encountered: %" PRIuFAST64 "\n"
+         "Total bytes compared: %" PRIuFAST64 "\n"
+      ,  pos, tgs.start_pos, differences, pos - tgs.start_pos
+   );
+   report_io_statistics();
+}
+
+/* Default size of the blocks hashed by the 'digest' mode. */
+#define DIGEST_BLOCK_SIZE (UINT32_C(1) << 20)
+
+/* First line of a manifest, without the leading "# ". */
+#define MANIFEST_HEADER "mediatester manifest: XXH64 of blocks of %zu bytes"
+
+/* Size of the regions whose error density is reported by -x. */
+#define STATS_REGION (1ul << 20)
+
+static unsigned popcount64(uint64_t x) {
+   x-= x >> 1 & 0x5555555555555555;
+   x= (x & 0x3333333333333333) + (x >> 2 & 0x3333333333333333);
+   x= x + (x >> 4) & 0x0f0f0f0f0f0f0f0f;
+   return (unsigned)(x * 0x0101010101010101 >> 56);
+}
+
+/* Loads the next 8 bytes at <p> as a word, but only <avail> of them if
+ * there are less. The byte order does not matter for the bit lanes. */
+static uint64_t load_word(uint8_t const *p, size_t avail) {
+   uint64_t w= 0;
+   memcpy(&w, p, avail < sizeof w ? avail : sizeof w);
+   return w;
+}
+
+/* Accumulates the -x statistics for the <size> bytes at <diff>, which have
+ * been XORed with the data stream at byte offset <pos> by xor_data().
+ * Scans 64 bits at once and only regenerates the expected data where it
+ * needs to tell the direction of bit flips. Returns the number of
+ * differing bytes and sets *<first> like process_segment(). */
+static uint_fast64_t collect_statistics(
+   uint8_t const *diff, size_t size, uint_fast64_t pos, uint_fast64_t *first
+) {
+   uint64_t const lsb= 0x0101010101010101;
+   uint_fast64_t differences= 0, bits= 0, flips[8][2];
+   uint_fast64_t density[DIM(tgs.stats.density)], worst= 0, worst_pos= 0;
+   size_t done= 0;
+   memset(flips, 0, sizeof flips); memset(density, 0, sizeof density);
+   while (done < size) {
+      size_t region= STATS_REGION
+         - (size_t)((pos + done - tgs.start_pos) % STATS_REGION)
+      ;
+      uint_fast64_t const region_pos= pos + done;
+      uint_fast64_t in_region= 0;
+      if (region > size - done) region= size - done;
+      while (region) {
+         uint8_t expected[256];
+         uint8_t const *x= diff + done;
+         size_t const n= region < sizeof expected ? region : sizeof expected;
+         size_t i;
+         uint64_t any= 0;
+         for (i= 0; i < n; i+= 8) any|= load_word(x + i, n - i);
+         if (any) {
+            generate_data(expected, n, pos + done);
+            for (i= 0; i < n; i+= 8) {
+               uint64_t const d= load_word(x + i, n - i);
+               uint64_t e, nonzero;
+               unsigned b;
+               if (!d) continue;
+               if (!differences) {
+                  size_t j;
+                  for (j= i; !x[j]; ++j) {}
+                  *first= pos + done + j;
+               }
+               nonzero= d | d >> 4; nonzero|= nonzero >> 2;
+               nonzero= (nonzero | nonzero >> 1) & lsb;
+               in_region+= popcount64(nonzero);
+               differences+= popcount64(nonzero);
+               bits+= popcount64(d);
+               e= load_word(expected + i, n - i);
+               for (b= 0; b < 8; ++b) {
+                  uint64_t const lane= d & lsb << b;
+                  flips[b][0]+= popcount64(lane & ~e);
+                  flips[b][1]+= popcount64(lane & e);
+               }
+            }
+         }
+         done+= n; region-= n;
+      }
+      if (in_region) {
+         unsigned k= 0;
+         uint_fast64_t t;
+         for (t= in_region; t >= 10 && k + 1 < DIM(density); t/= 10) ++k;
+         ++density[k];
+         if (in_region > worst) {
+            worst= in_region; worst_pos= region_pos;
+         }
+      }
+   }
+   if (differences) {
+      unsigned b;
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      tgs.stats.bits+= bits;
+      for (b= 0; b < 8; ++b) {
+         tgs.stats.flips[b][0]+= flips[b][0];
+         tgs.stats.flips[b][1]+= flips[b][1];
+      }
+      for (b= 0; b < DIM(density); ++b) tgs.stats.density[b]+= density[b];
+      if (
+            worst > tgs.stats.worst
+         || worst == tgs.stats.worst && worst_pos < tgs.stats.worst_pos
+      ) {
+         tgs.stats.worst= worst; tgs.stats.worst_pos= worst_pos;
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   }
+   return differences;
+}
+
+/* Adds <r> to the runs listed in tgs.stamps, joining it with a run it
+ * continues. Must be called with tgs.workers_mutex locked. */
+static void add_stamp_run(struct stamp_run const *r) {
+   struct stamp_run *const list= tgs.stamps.runs;
+   unsigned n= tgs.stamps.num_runs, i;
+   for (i= 0; i < n; ++i) {
+      struct stamp_run *const l= &list[i];
+      if (l->end == r->pos && r->source - l->source == r->pos - l->pos) {
+         l->end= r->end;
+         return;
+      }
+      if (r->end == l->pos && l->source - r->source == l->pos - r->pos) {
+         l->pos= r->pos; l->source= r->source;
+         return;
+      }
+      if (r->pos < l->pos) break;
+   }
+   if (i == DIM(tgs.stamps.runs)) {
+      tgs.stamps.truncated= 1;
+      return;
+   }
+   if (n == DIM(tgs.stamps.runs)) {
+      tgs.stamps.truncated= 1;
+      --n;
+   }
+   memmove(list + i + 1, list + i, (n - i) * sizeof *list);
+   list[i]= *r;
+   tgs.stamps.num_runs= n + 1;
+}
+
+/* Decodes the -T sector headers within the <size> bytes at <diff>, which
+ * have been XORed with the data stream at byte offset <pos> by
+ * xor_data(). A header XORed with the expected one yields zero if it
+ * matches. Otherwise, XORing the offset again yields the offset the
+ * sector has actually been written for, provided the fingerprint
+ * matches. */
+static void diagnose_stamps(
+   uint8_t const *diff, size_t size, uint_fast64_t pos
+) {
+   struct stamp_run runs[STAMP_MAX_RUNS], *run= 0;
+   uint_fast64_t aliased= 0, foreign= 0;
+   uint_fast64_t sector= pos + (STAMP_SECTOR_SIZE - pos % STAMP_SECTOR_SIZE)
+      % STAMP_SECTOR_SIZE
+   ;
+   int truncated= 0;
+   for (
+      ; sector + STAMP_HEADER_SIZE <= pos + size
+      ; sector+= STAMP_SECTOR_SIZE
+   ) {
+      uint8_t const *h= diff + (size_t)(sector - pos);
+      uint_fast64_t offset= 0, fingerprint= 0;
+      unsigned i;
+      for (i= 8; i--; ) {
+         offset= offset << 8 | h[i];
+         fingerprint= fingerprint << 8 | h[8 + i];
+      }
+      if (!offset && !fingerprint) continue; /* The stamp matches. */
+      if (fingerprint || offset % STAMP_SECTOR_SIZE) {
+         /* Written with another seed or without -T, or never written. */
+         ++foreign;
+         continue;
+      }
+      ++aliased;
+      offset^= sector;
+      if (
+            run && run->end == sector
+         && offset - run->source == sector - run->pos
+      ) {
+         run->end+= STAMP_SECTOR_SIZE;
+         continue;
+      }
+      if (run && run == runs + DIM(runs) - 1) {
+         truncated= 1;
+         continue;
+      }
+      run= run ? run + 1 : runs;
+      run->pos= sector; run->end= sector + STAMP_SECTOR_SIZE;
+      run->source= offset;
+   }
+   if (aliased || foreign) {
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      tgs.stamps.aliased+= aliased;
+      tgs.stamps.foreign+= foreign;
+      if (truncated) tgs.stamps.truncated= 1;
+      if (run) {
+         struct stamp_run const *r;
+         for (r= runs; r <= run; ++r) add_stamp_run(r);
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   }
+}
+
+/* Reports the results of diagnose_stamps() when -T is used. */
+static void report_stamps(void) {
+   unsigned i;
+   if (!tgs.stamps.enabled) return;
+   fprintf_c1(
+         stderr
+      ,  "Sectors containing data written for other byte offsets: %"
+         PRIuFAST64 "\n"
+      ,  tgs.stamps.aliased
+   );
+   for (i= 0; i < tgs.stamps.num_runs; ++i) {
+      struct stamp_run const *r= &tgs.stamps.runs[i];
+      fprintf_c1(
+            stderr
+         ,  "  byte offset %" PRIuFAST64 " through %" PRIuFAST64
+            ": data for byte offset %" PRIuFAST64 " through %" PRIuFAST64
+            "\n"
+         ,  r->pos, r->end - 1, r->source, r->source + (r->end - r->pos) - 1
+      );
+   }
+   if (tgs.stamps.truncated) {
+      fprintf_c1(stderr, "  (Further such sectors are not listed.)\n");
+   }
+   fprintf_c1(
+         stderr
+      ,  "Sectors without a valid stamp for this seed: %" PRIuFAST64 "\n"
+      ,  tgs.stamps.foreign
+   );
+}
+
+/* Verifies the <size> bytes at <data> against the data stream at byte
+ * offset <pos>, and diagnoses the sector stamps of -T. Returns the number
+ * of differing bytes and sets *<first> to the byte offset of the first
+ * one. */
+static uint_fast64_t verify_range(
+   uint8_t *data, size_t size, uint_fast64_t pos, uint_fast64_t *first
+) {
+   uint_fast64_t differences= 0;
+   if (!xor_data(data, size, pos)) return 0;
+   if (tgs.stamps.enabled) diagnose_stamps(data, size, pos);
+   if (tgs.stats.enabled) {
+      differences= collect_statistics(data, size, pos, first);
+   } else {
+      size_t i;
+      for (i= 0; i < size; ++i) {
+         if (data[i] && !differences++) *first= pos + i;
+      }
+   }
+   return differences;
+}
+
+/* Processes the work segment of <size> bytes at <segment>, which has been
+ * read from byte offset <pos>: Verifies it against the PRNG stream, or
+ * hashes its blocks, or verifies those hashes, depending on the mode.
+ * Returns the number of differing bytes or blocks, and sets *<first> to
+ * the byte offset of the first one. */
+static uint_fast64_t process_segment(
+   uint8_t *segment, size_t size, uint_fast64_t pos, uint_fast64_t *first
+) {
+   uint_fast64_t differences= 0;
+   if (tgs.mode == mode_verify) {
+      /* Only verify what is not within the holes of the buffer. */
+      struct hole const *h= tgs.holes.list[tgs.holes.current];
+      struct hole const *const stop= h + tgs.holes.count[tgs.holes.current];
+      size_t const base= (size_t)(segment - tgs.input.base);
+      size_t done= 0;
+      for (;; ++h) {
+         size_t end= size;
+         uint_fast64_t d, f;
+         if (h != stop) {
+            if (h->end <= base + done) continue;
+            if (h->start < base + size) {
+               end= h->start > base + done ? h->start - base : done;
+            }
+         }
+         if (end > done) {
+            if (
+                  (d= verify_range(segment + done, end - done, pos + done, &f))
+               && !differences
+            ) {
+               *first= f;
+            }
+            differences+= d;
+         }
+         if (h == stop || h->start >= base + size) break;
+         done= h->end - base;
+         if (done >= size) break;
+      }
+   } else {
+      uint_fast64_t *hash= tgs.digest.current
+         + (size_t)(segment - tgs.input.base) / tgs.digest.block
+      ;
+      size_t done;
+      for (done= 0; done < size; done+= tgs.digest.block, ++hash) {
+         size_t const block= size - done < tgs.digest.block
+            ? size - done : tgs.digest.block
+         ;
+         uint_fast64_t const h= xxh64(segment + done, block, 0);
+         if (tgs.mode == mode_digest) {
+            *hash= h;
+         } else if (h != *hash) {
+            if (!differences++) *first= pos + done;
+            fprintf_c1(
+                  stderr
+               ,  "Hash mismatch for block at byte offset %" PRIuFAST64 "!\n"
+               ,  pos + done
+            );
+         }
+      }
+   }
+   return differences;
+}
+
+/* Writes the hashes of the <bytes> just hashed in buffer <index> to the
+ * manifest. */
+static void write_hashes(unsigned index, size_t bytes) {
+   uint_fast64_t const *hash= tgs.digest.hashes[index];
+   uint_fast64_t pos= tgs.input.base_pos - tgs.start_pos;
+   while (bytes) {
+      size_t const block= bytes < tgs.digest.block ? bytes : tgs.digest.block;
+      fprintf_c1(
+            tgs.digest.manifest
+         ,  "%016" PRIxFAST64 " %" PRIuFAST64 " %zu\n", *hash++, pos, block
+      );
+      pos+= block; bytes-= block;
+      ++tgs.digest.blocks;
+   }
+}
+
+/* Loads the expected hashes of <bytes> starting at stream offset <pos>
+ * into buffer <index> from the manifest. Returns the number of those bytes
+ * covered by the manifest. */
+static size_t read_hashes(unsigned index, size_t bytes, uint_fast64_t pos) {
+   uint_fast64_t *hash= tgs.digest.hashes[index];
+   size_t covered= 0;
+   pos-= tgs.start_pos;
+   while (covered < bytes) {
+      uint_fast64_t offset;
+      size_t block;
+      int items;
+      if (
+         (
+            items= fscanf(
+                  tgs.digest.manifest
+               ,  "%" SCNxFAST64 " %" SCNuFAST64 " %zu", hash, &offset, &block
+            )
+         ) == EOF
+      ) {
+         if (ferror(tgs.digest.manifest)) ERROR_C1("Could not read manifest!");
+         break;
+      }
+      if (
+            items != 3 || offset != pos + covered || !block
+         || block > tgs.digest.block
+      ) {
+         ERROR_C1("Invalid manifest!");
+      }
+      ++hash; ++tgs.digest.blocks;
+      covered+= block;
+      /* Only the last block may be shorter. */
+      if (block < tgs.digest.block) break;
+   }
+   return covered < bytes ? covered : bytes;
+}
+
+/* Reports the statistics collected by collect_statistics() about <bytes>
+ * verified bytes. */
+static void report_statistics(uint_fast64_t bytes) {
+   uint_fast64_t const regions= CEIL_DIV(bytes, STATS_REGION);
+   uint_fast64_t damaged= 0, low= 1;
+   unsigned b;
+   fprintf_c1(
+      stderr, "Different bits encountered: %" PRIuFAST64 "\n", tgs.stats.bits
+   );
+   if (bytes) {
+      fprintf_c1(
+            stderr, "Bit error rate: %.3e\n"
+         ,  (double)tgs.stats.bits / 8 / (double)bytes
+      );
+   }
+   if (!tgs.stats.bits) return;
+   fprintf_c1(
+         stderr
+      ,  "Flipped bits by position within their byte (0 = least"
+         " significant):\n"
+   );
+   for (b= 0; b < 8; ++b) {
+      fprintf_c1(
+            stderr
+         ,  "  bit %u: %" PRIuFAST64 " read as 1 instead of 0, %" PRIuFAST64
+            " read as 0 instead of 1\n"
+         ,  b, tgs.stats.flips[b][0], tgs.stats.flips[b][1]
+      );
+   }
+   for (b= 0; b < DIM(tgs.stats.density); ++b) {
+      damaged+= tgs.stats.density[b];
+   }
+   fprintf_c1(
+         stderr
+      ,  "Regions of %lu bytes with different bytes: %" PRIuFAST64
+         " of %" PRIuFAST64 "\n"
+      ,  STATS_REGION, damaged, regions
+   );
+   for (b= 0; b < DIM(tgs.stats.density); ++b, low*= 10) {
+      if (!tgs.stats.density[b]) continue;
+      if (b + 1 < DIM(tgs.stats.density)) {
+         fprintf_c1(
+               stderr
+            ,  "  with %" PRIuFAST64 " through %" PRIuFAST64
+               " different bytes: %" PRIuFAST64 "\n"
+            ,  low, low * 10 - 1, tgs.stats.density[b]
+         );
+      } else {
+         fprintf_c1(
+               stderr
+            ,  "  with %" PRIuFAST64 " or more different bytes: %"
+               PRIuFAST64 "\n"
+            ,  low, tgs.stats.density[b]
+         );
+      }
+   }
+   fprintf_c1(
+         stderr
+      ,  "Worst region at byte offset %" PRIuFAST64 ": %" PRIuFAST64
+         " different bytes\n"
+      ,  tgs.stats.worst_pos, tgs.stats.worst
+   );
+}
+
+/* Reports any adjacent holes which have been recorded so far. */
+static void report_holes(void) {
+   if (!tgs.holes.bytes) return;
+   fprintf_c1(
+         stderr
+      ,  "Hole at byte offset %" PRIuFAST64 ": %" PRIuFAST64
+         " bytes have not been written\n"
+      ,  tgs.holes.pos, tgs.holes.bytes
+   );
+   tgs.holes.bytes= 0;
+}
+
+/* Records the hole of <bytes> at byte offset <pos> within buffer <index>
+ * starting at <base_pos>. */
+static void note_hole(
+   unsigned index, uint_fast64_t base_pos, uint_fast64_t pos, size_t bytes
+) {
+   struct hole *h= &tgs.holes.list[index][tgs.holes.count[index]++];
+   assert(tgs.holes.count[index] <= HOLES_PER_BUFFER);
+   h->start= (size_t)(pos - base_pos); h->end= h->start + bytes;
+   if (!tgs.holes.bytes || tgs.holes.pos + tgs.holes.bytes != pos) {
+      report_holes();
+      tgs.holes.pos= pos;
+      ++tgs.holes.extents;
+   }
+   tgs.holes.bytes+= bytes; tgs.holes.total+= bytes;
+}
+
+/* Like read_input_c1() for buffer <index> of the shared buffers, but skips
+ * and records the holes of a sparse regular file rather than reading their
+ * zeros. The returned count includes the holes. */
+static size_t read_buffer_c1(unsigned index, size_t size, uint_fast64_t pos) {
+   uint8_t *const buffer= tgs.shared_buffers[index];
+   size_t done= 0;
+   off_t end;
+   tgs.holes.count[index]= 0;
+   if (!tgs.holes.enabled) return read_input_c1(buffer, size, pos);
+   if ((end= lseek(STDIN_FILENO, 0, SEEK_END)) == (off_t)-1) {
+      unlikely_error: ERROR_C1(msg_exotic_error);
+   }
+   while (done < size && pos + done < (uint_fast64_t)end) {
+      uint_fast64_t const at= pos + done;
+      uint_fast64_t data= at, hole= (uint_fast64_t)end;
+      int const look= tgs.holes.count[index] < HOLES_PER_BUFFER;
+      size_t n, got;
+      if (look && tgs.holes.enabled) {
+         off_t o;
+         if ((o= lseek(STDIN_FILENO, (off_t)at, SEEK_DATA)) != (off_t)-1) {
+            data= (uint_fast64_t)o;
+         } else if (errno == ENXIO) {
+            data= (uint_fast64_t)end; /* There is only a hole left. */
+         } else {
+            tgs.holes.enabled= 0; /* The filesystem cannot tell. */
+         }
+      }
+      if (data > at) {
+         n= data - at < size - done ? (size_t)(data - at) : size - done;
+         note_hole(index, pos, at, n);
+         done+= n;
+         continue;
+      }
+      if (look && tgs.holes.enabled) {
+         off_t o;
+         if ((o= lseek(STDIN_FILENO, (off_t)at, SEEK_HOLE)) == (off_t)-1) {
+            goto unlikely_error;
+         }
+         hole= (uint_fast64_t)o;
+      }
+      n= hole - at < size - done ? (size_t)(hole - at) : size - done;
+      if (lseek(STDIN_FILENO, (off_t)at, SEEK_SET) == (off_t)-1) {
+         goto unlikely_error;
+      }
+      done+= got= read_input_c1(buffer + done, n, at);
+      if (got < n) break;
+   }
+   if (lseek(STDIN_FILENO, (off_t)(pos + done), SEEK_SET) == (off_t)-1) {
+      goto unlikely_error;
+   }
+   return done;
+}
+
+/* Reports the results of a threaded read mode after all input has been
+ * processed. */
+static void finish_reading(void) {
+   uint_fast64_t const pos= tgs.input.pos;
+   assert(pos >= tgs.start_pos);
+   report_holes();
+   fprintf_c1(
+         stderr
+      ,  "\n"
+         "%s complete!\n"
+         "\n"
+         "Reading stopped at byte offset %" PRIuFAST64 "!\n"
+         "(Reading did start at byte offset %" PRIuFAST64 ")\n"
+         "Total bytes read: %" PRIuFAST64 "\n"
+      ,  tgs.mode == mode_digest ? "Hashing" : "Verification"
+      ,  pos, tgs.start_pos, pos - tgs.start_pos
+   );
+   switch (tgs.mode) {
+      case mode_verify:
+         fprintf_c1(
+               stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+            ,  tgs.num_errors
+         );
+         if (tgs.stats.enabled) report_statistics(pos - tgs.start_pos);
+         report_stamps();
+         if (tgs.holes.extents) {
+            fprintf_c1(
+                  stderr
+               ,  "Bytes in holes which could not be verified: %" PRIuFAST64
+                  " in %" PRIuFAST64 " extents\n"
+               ,  tgs.holes.total, tgs.holes.extents
+            );
+         }
+         break;
+      case mode_verify_digest:
+      {
+         uint_fast64_t missing= 0, hash;
+         while (
+            fscanf(
+               tgs.digest.manifest, "%" SCNxFAST64 "%*[^\n]", &hash
+            ) == 1
+         ) {
+            ++missing;
+         }
+         if (ferror(tgs.digest.manifest)) {
+            ERROR_C1("Could not read manifest!");
+         }
+         fprintf_c1(
+               stderr
+            ,  "Blocks verified: %" PRIuFAST64 "\n"
+               "Blocks with hash mismatches: %" PRIuFAST64 "\n"
+            ,  tgs.digest.blocks, tgs.num_errors
+         );
+         if (missing) {
+            fprintf_c1(
+                  stderr
+               ,  "Blocks missing from the input: %" PRIuFAST64 "\n"
+               ,  missing
+            );
+            if (!tgs.num_errors) tgs.first_error_pos= pos;
+            tgs.num_errors+= missing;
+         }
+         break;
+      }
+      default:
+         fprintf_c1(
+            stderr, "Blocks hashed: %" PRIuFAST64 "\n", tgs.digest.blocks
+         );
+   }
+   if (tgs.num_errors) {
+      fprintf_c1(
+            stderr
+         ,  "First difference at byte offset %" PRIuFAST64 "\n"
+         ,  tgs.first_error_pos
+      );
+   }
+   report_io_statistics();
+}
+
+static void *reader_thread(void *unused_dummy) {
+   r4g *rc;
+   int *workers_mutex_procured;
+   struct perf_resource *perf;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   workers_mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
+   assert(!*workers_mutex_procured);
+   perf= perf_counters_c5();
+   /* Lock the mutex before acessing the global work state variables. */
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   *workers_mutex_procured= 1;
+   ++tgs.active_threads; /* We just have started. */
+   /* Thread main loop. */
+   for (;;) {
+      assert(*workers_mutex_procured);
+      assert(tgs.active_threads >= 1);
+      if (tgs.shutdown_requested) {
+         shutdown:
+         --tgs.active_threads;
+         break;
+      }
+      if (tgs.shared_buffer == tgs.shared_buffer_stop) {
+         /* All worker segments have already been assigned to some
+          * thread. */
+         if (tgs.active_threads == 1) {
+            /* And we are the first/last thread running! Let's do I/O then.
+             * Let the other threads process the buffer which has been read
+             * ahead, and read ahead into the buffer just processed
+             * meanwhile. */
+            unsigned const old= tgs.input.base != tgs.shared_buffers[0];
+            size_t got;
+            uint_fast64_t pos;
+            *workers_mutex_procured= 0;
+            pthread_mutex_unlock_c1(&tgs.workers_mutex);
+            if (tgs.input.primed) {
+               if (tgs.mode == mode_digest) {
+                  write_hashes(
+                        old
+                     ,  (size_t)(tgs.shared_buffer_stop - tgs.input.base)
+                  );
+               }
+               got= tgs.input.ahead;
+            } else {
+               /* Nothing has been read ahead yet. */
+               perf_begin(perf);
+               got= read_buffer_c1(
+                  !old, tgs.shared_buffer_size, tgs.input.pos
+               );
+               perf_end(perf, perf_io, got);
+               tgs.input.pos+= got;
+               tgs.input.primed= 1;
+            }
+            pos= tgs.input.pos - got;
+            if (tgs.mode == mode_verify_digest) {
+               size_t const covered= read_hashes(!old, got, pos);
+               /* Forget about any input beyond the manifest. */
+               tgs.input.pos-= got - covered;
+               got= covered;
+            }
+            pthread_mutex_lock_c1(&tgs.workers_mutex);
+            *workers_mutex_procured= 1;
+            if (!got) {
+               /* All input has been processed. */
+               finish_reading();
+               tgs.shutdown_requested= 1;
+               pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+               goto shutdown;
+            }
+            /* Switch buffers so other threads can resume working. */
+            tgs.shared_buffer= tgs.input.base= tgs.shared_buffers[!old];
+            tgs.shared_buffer_stop= tgs.shared_buffer + got;
+            tgs.digest.current= tgs.digest.hashes[!old];
+            tgs.holes.current= !old;
+            tgs.pos= tgs.input.base_pos= pos;
+            *workers_mutex_procured= 0;
+            pthread_mutex_unlock_c1(&tgs.workers_mutex);
+            /* Wake up the other threads so they can start working on the
+             * other buffer. */
+            pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+            /* Read ahead while the other threads process the new buffer. */
+            perf_begin(perf);
+            tgs.input.ahead= got < tgs.shared_buffer_size ? 0 : read_buffer_c1(
+               old, tgs.shared_buffer_size, tgs.input.pos
+            );
+            perf_end(perf, perf_io, tgs.input.ahead);
+            tgs.input.pos+= tgs.input.ahead;
+            pthread_mutex_lock_c1(&tgs.workers_mutex);
+            *workers_mutex_procured= 1;
+         } else {
+            assert(tgs.active_threads >= 2);
+            /* We have nothing to do, but other worker threads are still
+             * active. Just wait until there is again possibly something to
+             * do. */
+            --tgs.active_threads;
+            assert(*workers_mutex_procured);
+            *workers_mutex_procured= 0;
+            /* Unlock mutex, wait for a broadcast, then lock mutex again. */
+            pthread_cond_wait_c1(
+               &tgs.workers_wakeup_call, &tgs.workers_mutex
+            );
+            *workers_mutex_procured= 1;
+            ++tgs.active_threads;
+         }
+      } else {
+         /* There is more work to do. Seize the next work segment. */
+         uint8_t *work_segment= tgs.shared_buffer;
+         uint_fast64_t const pos= tgs.pos;
+         uint_fast64_t differences, first= 0;
+         size_t size= tgs.work_segment_sz;
+         if ((size_t)(tgs.shared_buffer_stop - work_segment) < size) {
+            size= (size_t)(tgs.shared_buffer_stop - work_segment);
+         }
+         tgs.shared_buffer+= size;
+         tgs.pos+= size;
+         ++tgs.busy_workers;
+         /* Allow other threads to seize work segments as well. */
+         *workers_mutex_procured= 0;
+         pthread_mutex_unlock_c1(&tgs.workers_mutex);
+         perf_begin(perf);
+         differences= process_segment(work_segment, size, pos, &first);
+         perf_end(perf, perf_processing, size);
+         pthread_mutex_lock_c1(&tgs.workers_mutex);
+         *workers_mutex_procured= 1;
+         --tgs.busy_workers;
+         if (differences) {
+            if (!tgs.num_errors || first < tgs.first_error_pos) {
+               tgs.first_error_pos= first;
+            }
+            tgs.num_errors+= differences;
+         }
+      }
+   }
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+static char const usage[]=
+   "Usage: %s [ <options> ... ] <mode> <seed_file> [ <starting_offset> ]\n"
+   "\n"
+   "where\n"
+   "\n"
+   "<mode>: One of the following commands\n"
+   "  write - write PRNG stream to standard output at offset\n"
+   "  verify - compare PRNG data against stream from standard input\n"
+   "  compare - Like verify but show every byte ('should' and 'is')\n"
+   "  diff - Like compare but report only differing bytes\n"
+   "  fill - write PRNG stream into files in <directory>\n"
+   "  check - verify the files created by 'fill'\n"
+   "  iops - measure and verify random reads from standard input\n"
+   "  digest - write manifest of hashes of the blocks of standard input\n"
+   "  verify-digest - verify standard input against such a manifest\n"
+   "  mixed - verify one region of standard input while writing another\n"
+   "<seed_file>: a binary (or text) file up to 256 bytes PRNG seed,\n"
+   "omitted with -p\n"
+   "<starting_offset>: byte offset where to start writing/verifying\n"
+   "\n"
+   "The modes 'fill' and 'check' expect a <directory> argument\n"
+   "directly after the <seed_file>. 'fill' writes consecutive parts\n"
+   "of the PRNG stream into files 00000000.bin, 00000001.bin etc.\n"
+   "until the filesystem is full, processing several files at the\n"
+   "same time. Files written after the first incomplete one are then\n"
+   "removed again. 'check' verifies all those files until it\n"
+   "encounters the first missing or incomplete one. This exercises\n"
+   "the filesystem and not just the underlying storage. Not with -w,\n"
+   "-d, -D, -L, -l, -m or -P.\n"
+   "\n"
+   "The modes 'digest' and 'verify-digest' expect a <manifest_file>\n"
+   "instead of the <seed_file> and work with arbitrary data rather than\n"
+   "with the PRNG stream, for instance in order to verify copies of a\n"
+   "disk image. 'digest' hashes every block of the input (see -c) with\n"
+   "XXH64 and writes the hashes into <manifest_file>. 'verify-digest'\n"
+   "hashes the blocks of the input again and reports blocks with\n"
+   "different hashes, as well as blocks listed in the manifest which are\n"
+   "missing from the input. The offsets in the manifest are relative to\n"
+   "<starting_offset>, so the copy may be located at a different offset\n"
+   "than the original. The hashes are calculated by the worker threads\n"
+   "like the PRNG data in the other modes.\n"
+   "\n"
+   "The mode 'mixed' verifies region A of standard input, which needs\n"
+   "to have been written with the same <seed_file> before, while it\n"
+   "writes region B directly following it at the same time. This is\n"
+   "how real workloads look, and some devices corrupt data or become\n"
+   "very slow only then. Region A starts at <starting_offset> and its\n"
+   "size must be set with -L. See -B and -R for the other parameters.\n"
+   "The same threads and buffers serve both directions, and the\n"
+   "throughput and latencies are reported for each direction. Standard\n"
+   "input must be a block device or a regular file which can be opened\n"
+   "for writing as well. The requests are 64 KiB unless set by -c.\n"
+   "Not with -D, -l, -m or -P.\n"
+   "\n"
+   "Standard input or output should be a block device or a file. When\n"
+   "writing to a file, writing stops when there is no more free space\n"
+   "left in the filesystem containing the file, or when the file has\n"
+   "reached the maximum file size supported by the filesystem.\n"
+   "\n"
+   "When 'verify' reads a regular file without -i, -I, -M or -o, the\n"
+   "holes of a sparse file are neither read nor compared. They are\n"
+   "reported as extents which have never been written, and\n"
+   "verification fails. With those options, holes are read and\n"
+   "compared like any other data.\n"
+   "\n"
+   "The <seed_file> determines which pseudo-random sequence of bytes\n"
+   "will be written to or will be expected to be read from the file\n"
+   "or device. The same <seed_file> needs to be used for a 'write'\n"
+   "command and its matching 'verify' command.\n"
+   "\n"
+   "The contents of <seed_file> are arbitrary and should be created\n"
+   "by something like this:\n"
+   "\n"
+   "$ dd if=/dev/random bs=1 count=16 > my_seed_file.bin\n"
+   "\n"
+   "<options>:\n"
+   "\n"
+   "-t <n>: Use <n> CPU threads for write/verify commands instead of\n"
+   "the autodetected number of available processor cores\n"
+   "\n"
+   "-A: Don't adapt the number of busy PRNG worker threads in write\n"
+   "mode. By default, the program measures how fast the worker\n"
+   "threads generate PRNG data compared to how fast the output\n"
+   "accepts it, and parks worker threads which are not needed for\n"
+   "keeping up with the output. -A keeps all worker threads busy.\n"
+   "\n"
+   "-r <rate>: Limit the I/O to <rate> bytes per second. <rate> may\n"
+   "have a suffix k, M, G or T for multiplying it with powers of\n"
+   "1024. Large I/O requests are split into smaller chunks which are\n"
+   "then paced, allowing about 16 chunks per second.\n"
+   "\n"
+   "-W <from>-<to>: Apply the limit set by -r only between the hours\n"
+   "<from> and <to> (0 through 24) of the local time, allowing full\n"
+   "speed outside of this time window. The window may wrap around\n"
+   "midnight, like in '-W 6-22' versus '-W 22-6'.\n"
+   "\n"
+   "-l <log_file>: Measure the throughput of every extent (see -e)\n"
+   "separately and write the results to <log_file> as CSV lines of\n"
+   "the format 'offset,bytes,elapsed_ns,bytes_per_second'. Only the\n"
+   "time spent in I/O requests is counted as elapsed time.\n"
+   "\n"
+   "-e <extent_size>: Size of the extents (64M by default) measured\n"
+   "by -l or -m. Suffixes are supported like for -r.\n"
+   "\n"
+   "-m <rate>: Report all regions slower than <rate> bytes per second\n"
+   "at the end. Useful for detecting slow zones or where the write\n"
+   "cache of a flash device has been exhausted.\n"
+   "\n"
+   "-S <milliseconds>: Warn about every single I/O request which\n"
+   "took longer than that. Defaults to 5000. 0 disables warnings.\n"
+   "\n"
+   "-P <seconds>: Report progress, throughput and percentiles of the\n"
+   "I/O request latencies at this interval. The latencies are also\n"
+   "reported at the end in any case.\n"
+   "\n"
+   "-d <kind>: Before writing to a block device, apply <kind> to all\n"
+   "of the device from the starting offset to its end. <kind> is one\n"
+   "of 'discard' (TRIM), 'secure' (secure discard) or 'zeroout'.\n"
+   "This is done by all threads in parallel, and the time required\n"
+   "is reported. Afterwards some blocks are read back, and it is\n"
+   "reported whether they contained zeros, the PRNG data of an older\n"
+   "run with the same seed, or other data.\n"
+   "\n"
+   "-D <kind>: Like -d, but applied after verifying or comparing.\n"
+   "\n"
+   "-w <dirty_limit>: When writing to a regular file or block device,\n"
+   "start the writeback of the page cache immediately after every\n"
+   "write, and wait for the writeback of older data as soon as more\n"
+   "than <dirty_limit> bytes have not been written back yet. Data\n"
+   "which has been written back is dropped from the cache. This\n"
+   "avoids bursts of writeback by the kernel and makes the reported\n"
+   "throughput reflect the real storage. Suffixes are supported like\n"
+   "for -r.\n"
+   "\n"
+   "-E <map_file>: Tolerate read errors when reading from a block\n"
+   "device or file. When a read request fails with an I/O error, it\n"
+   "is split in half repeatedly until the unreadable sectors have\n"
+   "been isolated. Within an area of consecutive bad sectors, the\n"
+   "distance skipped ahead without trying to read doubles with every\n"
+   "further bad sector. The unreadable (or skipped) extents are\n"
+   "written to <map_file> as lines '<byte_offset>,<bytes>' and are\n"
+   "not counted as differences. 'compare' marks their bytes with '?'.\n"
+   "Skipping never goes beyond the end of the input. Only supported\n"
+   "by the 'verify', 'compare' and 'diff' modes.\n"
+   "\n"
+   "-b <sizes>: Comma-separated list of request sizes for 'iops'.\n"
+   "Each size must be a multiple of 512. Suffixes are supported like\n"
+   "for -r. Defaults to 4k,16k,64k.\n"
+   "\n"
+   "-q <depths>: Comma-separated list of queue depths for 'iops'.\n"
+   "Every request size will be tested with every queue depth. The\n"
+   "queue depth is the number of threads issuing requests at the\n"
+   "same time. Defaults to 1,4,32.\n"
+   "\n"
+   "-s <seconds>: Duration of every test run by 'iops'. Defaults to\n"
+   "10 seconds. 'iops' does not support -r, -D, -l, -m or -P.\n"
+   "\n"
+   "-L <length>: Size of the range starting at <starting_offset>\n"
+   "from which 'iops' reads random blocks, or which is processed\n"
+   "with -o, -i, -M or -I. Not supported otherwise. Defaults to the\n"
+   "rest of the block device or file, but is mandatory when writing\n"
+   "to a regular file with -o. For 'iops', the whole range needs to\n"
+   "have been written with the same <seed_file> before, because all\n"
+   "data read is verified. For 'mixed', it is the size of region A\n"
+   "and mandatory. Suffixes are supported like for -r.\n"
+   "\n"
+   "-B <length>: Size of region B which 'mixed' writes after region A.\n"
+   "Defaults to the size of region A. Suffixes are supported like for\n"
+   "-r.\n"
+   "\n"
+   "-R <percent>: Share of read requests among all requests of 'mixed'\n"
+   "while both regions have chunks left. Once one region is done, the\n"
+   "rest of the other one follows alone. Defaults to 50.\n"
+   "\n"
+   "-o <order>: Write or verify the chunks of the range in the given\n"
+   "order rather than sequentially. <order> is one of 'sequential'\n"
+   "(the default), 'reverse', 'stride:<n>' (every <n>th chunk, then\n"
+   "the same starting with the following chunk etc.) or 'random' (a\n"
+   "pseudo-random permutation derived from <seed_file>). Each chunk\n"
+   "only depends on its offset, so data written in any order can be\n"
+   "verified in any other order. The chunks are processed in parallel\n"
+   "by the threads selected with -t, using positional I/O. Requires a\n"
+   "block device or a regular file. Progress (-P) and throughput (-l,\n"
+   "-m) are not reported.\n"
+   "\n"
+   "-c <chunk_size>: Size of the chunks reordered by -o, of the blocks\n"
+   "hashed by 'digest', or of the requests of 'mixed'. Must be a\n"
+   "multiple of 512. Defaults to the I/O block size for -o, to 1M for\n"
+   "'digest' and to 64K for 'mixed'. 'verify-digest'\n"
+   "uses the block size recorded in the manifest. Suffixes are\n"
+   "supported like for -r.\n"
+   "\n"
+   "-C <percent>: Make the data stream compressible rather than\n"
+   "random. The last <percent> percent of every 4 KiB unit consist\n"
+   "of a repeated 64 bit word. The data is still reproducible and\n"
+   "can be verified from any offset, but only with the same -C. This\n"
+   "allows measuring devices or filesystems which compress the data\n"
+   "transparently. An ideal compressor achieves a compression ratio\n"
+   "of about 100 / (100 - <percent>). Defaults to 0.\n"
+   "\n"
+   "-p <pattern>: Write or verify a fixed test pattern instead of the\n"
+   "PRNG stream, like badblocks does. The <seed_file> argument must\n"
+   "then be omitted. <pattern> is 'zeros', 'ones', a single byte\n"
+   "value like '0x55' or '0xaa' repeated everywhere, 'walking-ones'\n"
+   "(bytes 0x01, 0x02, 0x04 up to 0x80, repeated), 'walking-zeros'\n"
+   "(the complement of this), or 'address' (the 64 bit little endian\n"
+   "byte offset of every 8 bytes written there). The patterns are\n"
+   "generated and compared much faster than the PRNG stream. Run the\n"
+   "program once per pattern for several passes with different\n"
+   "patterns. Not for the digest modes, and not with -C or -n.\n"
+   "\n"
+   "-T: Stamp every sector of 512 bytes with a header instead of its\n"
+   "first 16 bytes of the PRNG stream: The byte offset of the sector\n"
+   "and a fingerprint of the seed. A sector which contains the wrong\n"
+   "data then tells which byte offset that data has been written for,\n"
+   "without any search. 'verify' lists such sectors, revealing for\n"
+   "instance the wrapped-around addresses of a device with fake\n"
+   "capacity, and counts sectors without a valid stamp for the seed,\n"
+   "such as never written ones. Data written with -T must be verified\n"
+   "with -T, and vice versa. Not for the digest modes, and not with\n"
+   "-C, -n or -p.\n"
+   "\n"
+   "-z <file_size>: Size of every file created by 'fill' and expected\n"
+   "by 'check'. Defaults to 1G. Suffixes are supported like for -r.\n"
+   "\n"
+   "-j <files>: Number of files processed concurrently by 'fill' and\n"
+   "'check', each one by its own thread. Defaults to 4.\n"
+   "\n"
+   "-x: Collect error statistics while verifying with 'verify': The\n"
+   "number of different bits and the bit error rate, how often every\n"
+   "bit position within a byte has been read as 1 instead of 0 or\n"
+   "vice versa (hinting at bits stuck at 1 or 0), and how densely the\n"
+   "different bytes are clustered in regions of 1 MiB. Costs almost\n"
+   "nothing while the data matches. Not supported with -o.\n"
+   "\n"
+   "-H: Count CPU cycles, instructions, cache misses and branch\n"
+   "misses of every worker thread with the hardware performance\n"
+   "counters, separately for generating or processing the data and\n"
+   "for doing I/O, and report them per byte at the end. Kernel code\n"
+   "is only included if permitted (see perf_event_paranoid). Only for\n"
+   "'write', 'verify', 'digest' and 'verify-digest' without -o. The\n"
+   "program just warns if no counters are available.\n"
+   "\n"
+   "-n: Write the generated data into the buffers with non-temporal\n"
+   "stores which bypass the CPU caches, where supported. The data is\n"
+   "only read again by the kernel or by DMA, so this avoids evicting\n"
+   "the PRNG tables and other working data of all cores. Compare the\n"
+   "throughput and the cache misses reported by -H with and without\n"
+   "-n to find out whether this helps on a particular machine. Only\n"
+   "for 'write' without -o, -M or -C.\n"
+   "\n"
+   "-i <input>: Verify <input> rather than standard input. May be\n"
+   "given up to 16 times in order to verify several inputs written\n"
+   "with the same seed at once. The expected data is then generated\n"
+   "only once for all of them, and every input gets its own reader\n"
+   "thread and its own results. Faster inputs can run ahead of the\n"
+   "slowest one by 32 MiB. Only for 'verify', and not with -D, -r,\n"
+   "-l, -m, -E, -x, -H, -M, -I, -o, -w, -S or -P.\n"
+   "\n"
+   "-M: Write or verify a regular file through memory mappings of its\n"
+   "chunks instead of write() or read(). The worker threads generate\n"
+   "the data directly into the page cache or compare it right there,\n"
+   "which avoids copying it. When writing, the space for every chunk\n"
+   "is allocated with fallocate() first, and the file is filled\n"
+   "until the filesystem is full unless -L is given. Only for 'write'\n"
+   "and 'verify' without -o. Progress (-P) and throughput (-l, -m)\n"
+   "are not reported.\n"
+   "\n"
+   "-I: Let every worker thread write or read its own segments of\n"
+   "1 MiB with pwrite() or pread(), instead of generating whole\n"
+   "buffers which a single thread writes or reads. The device then\n"
+   "receives as many concurrent requests as there are threads, which\n"
+   "suits NVMe drives and RAID arrays. Threads may be ahead of the\n"
+   "oldest unfinished segment by 4 segments per thread. Requires a\n"
+   "regular file or a block device. Writing a regular file stops when\n"
+   "the filesystem is full unless -L is given. Only for 'write' and\n"
+   "'verify' without -o or -M. Progress (-P) and throughput (-l, -m)\n"
+   "are not reported.\n"
+   "\n"
+   "-N: Don't be nice. By default, the program will behave as if it\n"
+   "had been invoked via 'nice' and 'ionice -n 6'. With -N, the\n"
+   "program will not do this and keep its initial niceness settings.\n"
+   "\n"
+   "-F: Don't flush the device's cache when reading from a block\n"
+   "device. This makes comparison of small block devices less\n"
+   "reliable, because one never can be sure whether the data read\n"
+   "came actually from the device or rather from the cache. However,\n"
+   "flushing device buffers is a privileged operation, so\n"
+   "unprivileged users can never read from a block device without\n"
+   "this option, even if they are the owner of the device.\n"
+   "\n"
+   "-V: Display version information\n"
+   "\n"
+   "-h: Display this help\n"
+   "\n"
+   "General usage procedure:\n"
+   "\n"
+   "1. Generate a seed file to be used with all following steps\n"
+   "\n"
+   "2. Fill the block device to be tested using the 'write' command\n"
+   "\n"
+   "   'write' can also fill a filesystem, using up all space. This\n"
+   "   allows to check how much uncompressible data can really be\n"
+   "   stored there, and whether the file has actually been written\n"
+   "   correctly (i. e. whether the filesystem works as it should).\n"
+   "\n"
+   "3. Use 'verify' command to check for differences\n"
+   "\n"
+   "   This reads back the data which has been written before and\n"
+   "   checks whether it is still the same. This should be the case\n"
+   "   if everything is fine.\n"
+   "   \n"
+   "   If it is not, 'verify' stops and reports the offset where the\n"
+   "   first different byte was detected.\n"
+   "   \n"
+   "   Differences mean that the storage medium or filesystem either\n"
+   "   does not reliably write data, or it does not reliably read\n"
+   "   data, or it is lying about its supposed storage capacity.\n"
+   "   Either way, such differences are always a bad sign.\n"
+   "   \n"
+   "   To scan for more differences, you can run the 'verify' command\n"
+   "   again, starting at a higher byte offset.\n"
+   "\n"
+   "4. If 'verify' stopped at differences, use 'compare' or 'diff'\n"
+   "   to show them.\n"
+   "\n"
+   "   For every byte offset, 'compare' shows the byte value which\n"
+   "   was expected, the byte value actually read back, the ASCII\n"
+   "   character corresponding to the value read back, and the bit\n"
+   "   differences (XOR) between both bytes.\n"
+   "   \n"
+   "   'diff' does the same, but only writes output lines for bytes\n"
+   "   which actually differ. (It will therefore never display the\n"
+   "   XOR-value '00000000'.)\n"
+   "   \n"
+   "   This means 'diff' does basically the same as 'verify', but it\n"
+   "   is much, much slower. And unlike 'verify', 'diff' will not\n"
+   "   stop comparing when differences have been found.\n"
+   "   \n"
+   "   Therefore, always use 'verify' first to determine where bytes\n"
+   "   start to differ, then use 'diff' or 'compare' to look what\n"
+   "   exactly is different.\n"
+   "   \n"
+   "   'compare' and 'diff' do not stop output by themselves before\n"
+   "   the end of the file/device has been reached. Their output\n"
+   "   should therefore be piped through 'head' or 'more' in order\n"
+   "   to limit the number of lines displayed.\n"
+   "\n"
+   VERSION_INFO "\n"
+;
+
+struct error_reporting_static_resource {
+   r4g_dtor dtor, *saved;
+   char const *argv0;
+};
+
+static void error_reporting_dtor(r4g *rc) {
+   char const *em= 0;
+   R4G_DEFINE_INIT_RPTR( \
+      struct error_reporting_static_resource, *c=, rc, dtor \
+   );
+   rc->rlist= c->saved;
+   if (rc->errors) {
+      if (!(em= rc->static_error_message)) em= msg_exotic_error;
+      if (!*em) em= 0;
+   }
+   if (em) {
+      (void)fprintf(stderr, "%s failed: %s\n", c->argv0, em);
+      clear_error_c1(rc);
+   }
+}
+
+struct minimal_resource {
+   r4g_dtor dtor, *saved;
+};
+
+static void resource_context_thread_key_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
+   /* Clear out slot for main thread context because it has not been
+    * allocated dynamically and should therefore not be passed to the
+    * thread key's per-thread slot destructor. */
+   int bad= pthread_setspecific(tgs.resource_context, 0);
+   rc->rlist= r->saved;
+   if (pthread_key_delete(tgs.resource_context) || bad) {
+      error_c1(rc, msg_exotic_error);
+   }
+}
+
+struct pthread_mutex_static_resource {
+   pthread_mutex_t *mutex;
+   r4g_dtor dtor, *saved;
+};
+
+static void pthread_mutex_static_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct pthread_mutex_static_resource, *r=, rc, dtor);
+   rc->rlist= r->saved;
+   if (pthread_mutex_destroy(r->mutex)) ERROR_C1(msg_exotic_error);
+}
+
+struct pthread_cond_static_resource {
+   pthread_cond_t *cond;
+   r4g_dtor dtor, *saved;
+};
+
+static void pthread_cond_static_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct pthread_cond_static_resource, *r=, rc, dtor);
+   rc->rlist= r->saved;
+   if (pthread_cond_destroy(r->cond)) ERROR_C1(msg_exotic_error);
+}
+
+static void shared_buffers_dtor(r4g *rc) {
+   {
+      unsigned i;
+      for (i= (unsigned)DIM(tgs.shared_buffers); i--; ) {
+         if (tgs.shared_buffers[i]) {
+            void *old= tgs.shared_buffers[i]; tgs.shared_buffers[i]= 0;
+            if (munmap(old, tgs.shared_buffer_size)) {
+               error_c1(rc, msg_exotic_error);
+            }
+         }
+      }
+   }
+   {
+      R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
+      rc->rlist= r->saved;
+   }
+}
+
+static void salvage_map_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
+   rc->rlist= r->saved;
+   log_unreadable_extent();
+}
+
+static void slow_regions_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
+   rc->rlist= r->saved;
+   free(tgs.tput.slow); tgs.tput.slow= 0;
+}
+
+struct cancel_threads_static_resource {
+   unsigned threads;
+   pthread_t *tid;
+   char *tvalid;
+   r4g_dtor dtor, *saved;
+};
+
+static void cancel_threads_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct cancel_threads_static_resource, *r=, rc, dtor);
+   {
+      unsigned i;
+      for (i= r->threads; i--; ) {
+         if (r->tvalid[i]) {
+            r->tvalid[i]= 0;
+            if (rc->errors) {
+               if (pthread_cancel(r->tid[i])) {
+                  error_c1(rc, "Could not terminate child thread!");
+               }
+            }
+            {
+               void *thread_error;
+               if (pthread_join(r->tid[i], &thread_error)) {
+                  error_c1(
+                     rc, "Failure waiting for child thread to terminate!"
+                  );
+               }
+               if (thread_error && thread_error != PTHREAD_CANCELED) {
+                  error_c1(rc, thread_error);
+               }
+            }
+         }
+      }
+   }
+   rc->rlist= r->saved;
+}
+
+struct mallocated_resource {
+   void *buffer;
+   r4g_dtor dtor, *saved;
+};
+
+static void mallocated_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct mallocated_resource, *r=, rc, dtor);
+   void *buffer= r->buffer;
+   rc->rlist= r->saved;
+   free(r);
+   free(buffer);
+}
+
+static void *calloc_c5(size_t num_elements, size_t element_size) {
+   struct mallocated_resource *r= malloc_c1(sizeof *r);
+   r4g *rc;
+   r->saved= (rc= r4g_c1())->rlist;
+   r->dtor= &mallocated_dtor; rc->rlist= &r->dtor;
+   if (!(r->buffer= calloc(num_elements, element_size))) {
+      error_c1(rc, msg_malloc_error);
+   }
+   return r->buffer;
+}
+
+/* Discard requests will be issued for ranges of this size in parallel. */
+#define DISCARD_BATCH_SIZE (UINT64_C(1) << 30)
+
+static struct {
+   char const *name;
+   unsigned long request;
+} const discard_kinds[]= {
+   {"discard", BLKDISCARD}, {"secure", BLKSECDISCARD}, {"zeroout", BLKZEROOUT}
+};
+
+static void *discard_thread(void *unused_dummy) {
+   r4g *rc;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   for (;;) {
+      uint64_t range[2];
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if ((range[0]= tgs.discard.pos) < tgs.discard.end) {
+         if ((range[1]= tgs.discard.end - range[0]) > DISCARD_BATCH_SIZE) {
+            range[1]= DISCARD_BATCH_SIZE;
+         }
+         tgs.discard.pos+= range[1];
+      } else {
+         range[1]= 0;
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (!range[1]) break;
+      if (ioctl(tgs.discard.fd, tgs.discard.request, range) < 0) {
+         (void)fprintf(
+               stderr
+            ,  "Could not discard %" PRIu64 " bytes at byte offset %" PRIu64
+               ": %s\n"
+            ,  range[1], range[0], strerror(errno)
+         );
+         error_c1(rc, "Discarding has failed!");
+      }
+   }
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Runs <start> in <threads> new threads and waits until all of them have
+ * terminated. */
+static void run_threads_c1(unsigned threads, void *(*start)(void *)) {
+   struct cancel_threads_static_resource r;
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   r.tid= calloc_c5(threads, sizeof *r.tid);
+   r.tvalid= calloc_c5(threads, sizeof *r.tvalid);
+   r.threads= threads;
+   r.saved= rc->rlist; r.dtor= &cancel_threads_dtor; rc->rlist= &r.dtor;
+   {
+      unsigned i;
+      for (i= threads; i--; ) {
+         if (pthread_create(&r.tid[i], 0, start, 0)) {
+            error_c1(rc, "Could not create worker thread!");
+         }
+         r.tvalid[i]= 1;
+      }
+   }
+   release_to_c1(rc, marker);
+}
+
+static unsigned available_processors_c1(void) {
+   long const rc= sysconf(_SC_NPROCESSORS_ONLN);
+   if (rc == -1 || (long)(unsigned)rc != rc) {
+      ERROR_C1("Could not determine number of available CPU processors!");
+   }
+   return (unsigned)rc;
+}
+
+/* Returns <fd> if its access mode is compatible with <access> (O_RDONLY,
+ * O_WRONLY or O_RDWR). Otherwise, returns a new file descriptor for the
+ * same file, opened with <access> and <flags>, or -1 if this is not
+ * possible. */
+static int fd_for_access(int fd, int access, int flags) {
+   int mode;
+   if ((mode= fcntl(fd, F_GETFL)) == -1) ERROR_C1(msg_exotic_error);
+   if ((mode&= O_ACCMODE) == O_RDWR || mode == access) return fd;
+   {
+      char path[sizeof "/proc/self/fd/" + 3 * sizeof fd];
+      (void)sprintf(path, "/proc/self/fd/%d", fd);
+      return open(path, access | flags);
+   }
+}
+
+/* Discards the device from the starting offset to its end using the
+ * discard_kinds[] entry <kind> and reports how long this took. Then reads
+ * back some samples from the discarded range and reports what they
+ * contained. */
+static void discard_pass_c1(unsigned kind) {
+   int const fd= tgs.discard.fd;
+   uint_fast64_t started;
+   {
+      uint64_t size;
+      if (ioctl(fd, BLKGETSIZE64, &size) < 0) {
+         ERROR_C1("Unable to determine block device size!");
+      }
+      tgs.discard.pos= tgs.start_pos; tgs.discard.end= size;
+   }
+   if (tgs.discard.pos >= tgs.discard.end) return;
+   if ((tgs.discard.fd= fd_for_access(fd, O_WRONLY, 0)) == -1) {
+      ERROR_C1("Could not open the block device for discarding!");
+   }
+   tgs.discard.request= discard_kinds[kind].request;
+   fprintf_c1(
+         stderr
+      ,  "\nApplying '%s' to byte offsets %" PRIuFAST64 " through %"
+         PRIuFAST64 "...\n"
+      ,  discard_kinds[kind].name, tgs.discard.pos, tgs.discard.end - 1
+   );
+   started= monotonic_ns();
+   run_threads_c1(tgs.threads, &discard_thread);
+   if (tgs.discard.fd != fd) {
+      if (close(tgs.discard.fd)) ERROR_C1(msg_exotic_error);
+      tgs.discard.fd= fd;
+   }
+   fprintf_c1(
+         stderr, "Done after %.3f seconds.\n", (monotonic_ns() - started) / 1e9
+   );
+   {
+      #define SAMPLES 16
+      unsigned i, zeros= 0, stale= 0, other= 0;
+      int in;
+      uint8_t *sample= tgs.shared_buffers[0];
+      if ((in= fd_for_access(fd, O_RDONLY, 0)) == -1) {
+         fprintf_c1(
+            stderr, "Cannot check what discarded blocks read back as.\n"
+         );
+         return;
+      }
+      for (i= 0; i < SAMPLES; ++i) {
+         uint_fast64_t pos= tgs.start_pos + (
+               (tgs.discard.end - tgs.start_pos) / SAMPLES * i
+            /  tgs.blksz * tgs.blksz
+         );
+         size_t j;
+         if (
+            pread(in, sample, tgs.blksz, (off_t)pos) != (ssize_t)tgs.blksz
+         ) {
+            break;
+         }
+         for (j= tgs.blksz; j--; ) if (sample[j]) break;
+         if (j == (size_t)-1) {
+            ++zeros;
+         } else {
+            if (compare_data(sample, tgs.blksz, pos) < tgs.blksz) {
+               ++other;
+            } else {
+               ++stale;
+            }
+         }
+      }
+      if (in != fd && close(in)) ERROR_C1(msg_exotic_error);
+      fprintf_c1(
+            stderr
+         ,  "Blocks sampled from the discarded range: %u\n"
+            "Sampled blocks reading back as zeros: %u\n"
+            "Sampled blocks still containing the PRNG data: %u\n"
+            "Sampled blocks containing other data: %u\n"
+         ,  i, zeros, stale, other
+      );
+      if (i < SAMPLES) {
+         fprintf_c1(stderr, "Could not read back all samples!\n");
+      }
+      #undef SAMPLES
+   }
+}
+
+static void discard_post_pass_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct minimal_resource, *r=, rc, dtor);
+   rc->rlist= r->saved;
+   if (!rc->errors) discard_pass_c1(tgs.discard.post - 1);
+}
+
+struct report_times_static_resource {
+   struct timespec started;
+   r4g_dtor dtor, *saved;
+};
+
+static void report_times(char const *name, time_t seconds) {
+   fprintf_c1(
+         stderr
+      ,  "%s\t%lu seconds = %.1f minutes = %.2f hours\n"
+      ,  name
+      ,  (unsigned long)seconds
+      ,  seconds / 60.
+      ,  seconds / (60. * 60)
+   );
+}
+
+static void report_times_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct report_times_static_resource, *r=, rc, dtor);
+   struct timespec real;
+   struct rusage ru;
+   rc->rlist= r->saved;
+   if (clock_gettime(CLOCK_MONOTONIC, &real) < 0) goto unlikely_error;
+   real.tv_sec-= r->started.tv_sec + (
+      real.tv_nsec < r->started.tv_nsec /* borrow */
+   );
+   if (getrusage(RUSAGE_SELF, &ru) < 0) unlikely_error: ERROR_C1(0);
+   fprintf_c1(stderr, "\n");
+   report_times("real", real.tv_sec);
+   report_times("user", ru.ru_utime.tv_sec);
+   report_times("sys", ru.ru_stime.tv_sec);
+}
+
+static void report_times_c5(void) {
+   static struct report_times_static_resource r;
+   r4g *rc= r4g_c1();
+   if (clock_gettime(CLOCK_MONOTONIC, &r.started) < 0) {
+      error_c1(rc, msg_exotic_error);
+   }
+   r.saved= rc->rlist; r.dtor= &report_times_dtor; rc->rlist= &r.dtor;
+}
+
+/* Size of the chunks read or written at once in the directory modes. */
+#define DIR_CHUNK_SIZE (UINT32_C(1) << 20)
+
+static void *dir_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t *buffer;
+   struct latency_histogram *latency;
+   int const fill= tgs.mode == mode_fill;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   buffer= calloc_c5(DIR_CHUNK_SIZE, 1);
+   latency= calloc_c5(1, sizeof *latency);
+   for (;;) {
+      unsigned index;
+      int fd, full= 0;
+      uint_fast64_t pos, done= 0, differences= 0, first_difference= 0;
+      char name[sizeof "00000000.bin" + 3 * sizeof index];
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if ((index= tgs.dir.next) < tgs.dir.stop) ++tgs.dir.next;
+      else index= (unsigned)-1;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (index == (unsigned)-1) break;
+      (void)sprintf(name, "%08u.bin", index);
+      pos= tgs.start_pos + index * tgs.dir.file_size;
+      if (
+         (
+            fd= openat(
+                  tgs.dir.fd, name
+               ,  fill ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY, 0666
+            )
+         ) == -1
+      ) {
+         switch (errno) {
+            case ENOSPC: case EDQUOT: if (fill) goto stop; break;
+            case ENOENT: if (!fill) goto stop; break;
+         }
+         file_error:
+         (void)fprintf(
+            stderr, "Error accessing file \"%s\": %s\n", name, strerror(errno)
+         );
+         error_c1(rc, fill ? msg_write_error : "Read error!");
+      }
+      if (fill && fallocate(fd, 0, 0, (off_t)tgs.dir.file_size)) {
+         switch (errno) {
+            /* Let write() find out whether there is enough space. */
+            case EOPNOTSUPP: case ENOSYS: case ENOSPC: case EDQUOT:
+            case EFBIG:
+               break;
+            default: goto file_error;
+         }
+      }
+      while (done < tgs.dir.file_size && !full) {
+         ssize_t did;
+         size_t chunk= DIR_CHUNK_SIZE;
+         uint_fast64_t started;
+         if (tgs.dir.file_size - done < chunk) {
+            chunk= (size_t)(tgs.dir.file_size - done);
+         }
+         if (fill) generate_data(buffer, chunk, pos + done);
+         chunk= throttle_c1(chunk);
+         started= monotonic_ns();
+         did= fill ? write(fd, buffer, chunk) : read(fd, buffer, chunk);
+         started= monotonic_ns() - started;
+         if (did <= 0) {
+            if (did == 0) break;
+            switch (errno) {
+               case EINTR: continue;
+               case ENOSPC: case EDQUOT: case EFBIG:
+                  if (fill) { full= 1; continue; }
+            }
+            goto file_error;
+         }
+         record_latency(latency, started);
+         warn_about_stalls(pos + done, (size_t)did, started);
+         if (!fill && xor_data(buffer, (size_t)did, pos + done)) {
+            size_t i;
+            for (i= 0; i < (size_t)did; ++i) {
+               if (buffer[i] && !differences++) first_difference= done + i;
+            }
+         }
+         done+= (uint_fast64_t)did;
+      }
+      /* Drop any space preallocated beyond the data actually written. */
+      if (full && ftruncate(fd, (off_t)done)) goto file_error;
+      if (close(fd)) {
+         if (!fill || errno != ENOSPC && errno != EDQUOT) goto file_error;
+         full= 1;
+      }
+      /* Only the last file may be shorter than the others. */
+      if (done < tgs.dir.file_size) full= 1;
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      ++tgs.dir.files;
+      tgs.dir.bytes+= done;
+      if (differences) {
+         if (
+               !tgs.num_errors
+            || pos + first_difference < tgs.first_error_pos
+         ) {
+            tgs.first_error_pos= pos + first_difference;
+         }
+         tgs.num_errors+= differences;
+         (void)fprintf(
+               stderr
+            ,  "File \"%s\": %" PRIuFAST64 " different bytes, the first one"
+               " at offset %" PRIuFAST64 " within the file\n"
+            ,  name, differences, first_difference
+         );
+      }
+      if (full && index + 1 < tgs.dir.stop) tgs.dir.stop= index + 1;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      continue;
+      stop:
+      /* Do not process any files after this one. */
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if (index < tgs.dir.stop) tgs.dir.stop= index;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   }
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   merge_latencies(&tgs.latency, latency);
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+struct fd_resource {
+   int fd;
+   r4g_dtor dtor, *saved;
+};
+
+static void fd_dtor(r4g *rc) {
+   R4G_DEFINE_INIT_RPTR(struct fd_resource, *r=, rc, dtor);
+   int fd= r->fd;
+   rc->rlist= r->saved;
+   free(r);
+   if (fd != -1 && close(fd)) error_c1(rc, msg_exotic_error);
+}
+
+/* When the filesystem became full, other threads may already have written
+ * files after the first incomplete one. Removes those files, so that
+ * 'fill' reports the same capacity which 'check' will verify. */
+static void remove_files_beyond_stop_c1(void) {
+   unsigned index, removed= 0;
+   for (index= tgs.dir.stop; index < tgs.dir.next; ++index) {
+      char name[sizeof "00000000.bin" + 3 * sizeof index];
+      struct stat st;
+      (void)sprintf(name, "%08u.bin", index);
+      if (fstatat(tgs.dir.fd, name, &st, 0)) {
+         if (errno == ENOENT) continue; /* It could not be created. */
+         remove_error:
+         (void)fprintf(
+            stderr, "Error removing file \"%s\": %s\n", name, strerror(errno)
+         );
+         ERROR_C1(msg_write_error);
+      }
+      if (unlinkat(tgs.dir.fd, name, 0)) goto remove_error;
+      tgs.dir.bytes-= (uint_fast64_t)st.st_size;
+      --tgs.dir.files;
+      ++removed;
+   }
+   if (removed) {
+      fprintf_c1(
+            stderr
+         ,  "Removed %u files written after the first incomplete one.\n"
+         ,  removed
+      );
+   }
+}
+
+/* Fills directory <path> with files containing consecutive parts of the
+ * PRNG stream in fill mode, or verifies those files in check mode. */
+static void directory_mode_c1(char const *path) {
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   int const fill= tgs.mode == mode_fill;
+   {
+      struct fd_resource *r= malloc_c1(sizeof *r);
+      r->saved= rc->rlist; r->dtor= &fd_dtor; rc->rlist= &r->dtor;
+      if ((r->fd= tgs.dir.fd= open(path, O_RDONLY | O_DIRECTORY)) == -1) {
+         error_c1(rc, "Cannot open directory!");
+      }
+   }
+   tgs.start_pos= tgs.pos;
+   if (tgs.throttle.rate) init_throttle_c1(1, DIR_CHUNK_SIZE);
+   {
+      uint_fast64_t files= (UINT_FAST64_MAX - tgs.start_pos)
+         / tgs.dir.file_size
+      ;
+      tgs.dir.stop= files < (unsigned)-1 ? (unsigned)files : (unsigned)-1;
+   }
+   fprintf_c1(
+         stderr
+      ,  "Starting stream offset: %" PRIuFAST64 " bytes\n"
+         "size of every file: %" PRIuFAST64 " bytes\n"
+         "number of files processed concurrently: %u\n"
+         "\n%s files %s directory \"%s\"...\n"
+      ,  tgs.start_pos, tgs.dir.file_size, tgs.dir.streams
+      ,  fill ? "writing" : "verifying", fill ? "into" : "in", path
+   );
+   report_times_c5();
+   {
+      uint_fast64_t started= monotonic_ns();
+      run_threads_c1(tgs.dir.streams, &dir_thread);
+      started= monotonic_ns() - started;
+      if (fill) remove_files_beyond_stop_c1();
+      fprintf_c1(
+            stderr
+         ,  "\n"
+            "%s complete!\n"
+            "\n"
+            "Files %s: %u\n"
+            "Total bytes %s: %" PRIuFAST64 "\n"
+            "Average throughput: %.0f bytes per second\n"
+         ,  fill ? "Filling" : "Verification"
+         ,  fill ? "written" : "verified", tgs.dir.files
+         ,  fill ? "written" : "verified", tgs.dir.bytes
+         ,  tgs.dir.bytes * 1e9 / (started ? started : 1)
+      );
+   }
+   if (!fill) {
+      fprintf_c1(
+         stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+         , tgs.num_errors
+      );
+      if (tgs.num_errors) {
+         fprintf_c1(
+               stderr
+            ,  "First difference at stream offset %" PRIuFAST64 "\n"
+            ,  tgs.first_error_pos
+         );
+      }
+   }
+   fprintf_c1(
+      stderr, "I/O requests: %" PRIuFAST64 ", ", tgs.latency.requests
+   );
+   report_latencies(&tgs.latency);
+   fprintf_c1(stderr, "\n");
+   release_to_c1(rc, marker);
+   if (tgs.num_errors) error_c1(rc, "Differences have been found!");
+}
+
+/* SplitMix64. Good enough for picking random blocks. */
+static uint_fast64_t next_random(uint_fast64_t *state) {
+   uint_fast64_t z= *state+= UINT64_C(0x9e3779b97f4a7c15);
+   z= (z ^ z >> 30) * UINT64_C(0xbf58476d1ce4e5b9);
+   z= (z ^ z >> 27) * UINT64_C(0x94d049bb133111eb);
+   return z ^ z >> 31;
+}
+
+static void *aligned_alloc_c5(size_t alignment, size_t size) {
+   struct mallocated_resource *r= malloc_c1(sizeof *r);
+   r4g *rc;
+   r->saved= (rc= r4g_c1())->rlist;
+   r->dtor= &mallocated_dtor; rc->rlist= &r->dtor;
+   if (posix_memalign(&r->buffer, alignment, size)) {
+      r->buffer= 0;
+      error_c1(rc, msg_malloc_error);
+   }
+   return r->buffer;
+}
+
+/* Limits tgs.length to the part of the block device or regular file <fd>
+ * after the starting offset. When <writing>, a regular file can grow and
+ * tgs.length is used as it is. */
+static void set_range_length_c1(int fd, int writing) {
+   uint_fast64_t size;
+   struct stat st;
+   if (fstat(fd, &st)) ERROR_C1(msg_exotic_error);
+   size= (uint_fast64_t)st.st_size;
+   if (S_ISBLK(st.st_mode)) {
+      uint64_t bytes;
+      if (ioctl(fd, BLKGETSIZE64, &bytes) < 0) {
+         ERROR_C1("Unable to determine block device size!");
+      }
+      size= bytes;
+   } else if (!S_ISREG(st.st_mode)) {
+      ERROR_C1("This mode requires a regular file or a block device!");
+   } else if (writing) {
+      if (!tgs.length) ERROR_C1("The size of the range must be set with -L!");
+      return;
+   }
+   if (size < tgs.start_pos) size= tgs.start_pos;
+   size-= tgs.start_pos;
+   if (!tgs.length || tgs.length > size) tgs.length= size;
+   if (!tgs.length) ERROR_C1("Nothing to do after the starting offset!");
+}
+
+/* Reads random blocks from the tested range until the deadline, and
+ * verifies every block against the PRNG stream. */
+static void *iops_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t *buffer;
+   struct latency_histogram *latency;
+   uint_fast64_t state, differences= 0, first_difference= 0;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   buffer= aligned_alloc_c5(4096, tgs.iops.size);
+   latency= calloc_c5(1, sizeof *latency);
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   state= tgs.iops.seeds++;
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   while (monotonic_ns() < tgs.iops.deadline_ns) {
+      uint_fast64_t const pos= tgs.start_pos
+         + next_random(&state) % tgs.iops.blocks * tgs.iops.size
+      ;
+      uint_fast64_t started;
+      ssize_t did_read;
+      started= monotonic_ns();
+      did_read= pread(tgs.iops.fd, buffer, tgs.iops.size, (off_t)pos);
+      started= monotonic_ns() - started;
+      if (did_read != (ssize_t)tgs.iops.size) {
+         if (did_read == -1 && errno == EINTR) continue;
+         (void)fprintf(
+               stderr
+            ,  "Read error at byte offset %" PRIuFAST64 ": %s\n"
+            ,  pos, did_read == -1 ? strerror(errno) : "Short read"
+         );
+         error_c1(rc, "Read error!");
+      }
+      record_latency(latency, started);
+      warn_about_stalls(pos, tgs.iops.size, started);
+      if (xor_data(buffer, tgs.iops.size, pos)) {
+         size_t i;
+         for (i= 0; i < tgs.iops.size; ++i) {
+            if (
+                  buffer[i]
+               && (!differences++ || pos + i < first_difference)
+            ) {
+               first_difference= pos + i;
+            }
+         }
+      }
+   }
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   merge_latencies(&tgs.latency, latency);
+   if (differences) {
+      if (!tgs.num_errors || first_difference < tgs.first_error_pos) {
+         tgs.first_error_pos= first_difference;
+      }
+      tgs.num_errors+= differences;
+   }
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Measures random read performance of standard input for every
+ * combination of request size and queue depth, while verifying all data
+ * read. The queue depth is emulated by the same number of threads, each
+ * one issuing synchronous requests. */
+static void iops_mode_c1(void) {
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   int direct= 1;
+   set_range_length_c1(STDIN_FILENO, 0);
+   {
+      struct fd_resource *r= malloc_c1(sizeof *r);
+      r->saved= rc->rlist; r->dtor= &fd_dtor; rc->rlist= &r->dtor;
+      /* Bypass the page cache, or the same blocks would soon be read from
+       * RAM rather than from the medium. */
+      {
+         char path[sizeof "/proc/self/fd/" + 3 * sizeof r->fd];
+         (void)sprintf(path, "/proc/self/fd/%d", STDIN_FILENO);
+         if ((r->fd= open(path, O_RDONLY | O_DIRECT)) == -1) direct= 0;
+      }
+      tgs.iops.fd= direct ? r->fd : STDIN_FILENO;
+   }
+   {
+      unsigned i;
+      for (i= tgs.iops.num_sizes; i--; ) {
+         if (tgs.iops.sizes[i] > tgs.length) {
+            error_c1(
+               rc, "The tested range is smaller than the request size!"
+            );
+         }
+      }
+   }
+   fprintf_c1(
+         stderr
+      ,  "Starting input offset: %" PRIuFAST64 " bytes\n"
+         "size of tested range: %" PRIuFAST64 " bytes\n"
+         "duration of every test: %" PRIuFAST64 " seconds\n"
+         "direct I/O: %s\n"
+         "\nmeasuring random reads from standard input...\n\n"
+      ,  tgs.start_pos, tgs.length, tgs.iops.seconds
+      ,  direct ? "yes" : "no (data may come from the page cache)"
+   );
+   report_times_c5();
+   {
+      unsigned i, j;
+      for (i= 0; i < tgs.iops.num_sizes; ++i) {
+         tgs.iops.size= (size_t)tgs.iops.sizes[i];
+         tgs.iops.blocks= tgs.length / tgs.iops.size;
+         for (j= 0; j < tgs.iops.num_depths; ++j) {
+            unsigned const depth= (unsigned)tgs.iops.depths[j];
+            uint_fast64_t started;
+            double seconds;
+            (void)memset(&tgs.latency, 0, sizeof tgs.latency);
+            tgs.iops.deadline_ns= (started= monotonic_ns())
+               + tgs.iops.seconds * 1000000000u
+            ;
+            run_threads_c1(depth, &iops_thread);
+            /* Requests still running at the deadline have been counted,
+             * so include the time until they completed. */
+            seconds= (monotonic_ns() - started) / 1e9;
+            fprintf_c1(
+                  stderr
+               ,  "request size %zu, queue depth %u: %.0f IOPS, %.0f bytes"
+                  " per second, "
+               ,  tgs.iops.size, depth
+               ,  (double)tgs.latency.requests / seconds
+               ,  (double)tgs.latency.requests * tgs.iops.size / seconds
+            );
+            report_latencies(&tgs.latency);
+            fprintf_c1(stderr, "\n");
+         }
+      }
+   }
+   fprintf_c1(
+         stderr
+      ,  "\nDifferent bytes encountered (summed over all reads): %"
+         PRIuFAST64 "\n"
+      ,  tgs.num_errors
+   );
+   if (tgs.num_errors) {
+      fprintf_c1(
+            stderr
+         ,  "Lowest byte offset with a difference: %" PRIuFAST64 "\n"
+         ,  tgs.first_error_pos
+      );
+   }
+   release_to_c1(rc, marker);
+   if (tgs.num_errors) error_c1(rc, "Differences have been found!");
+}
+
+/* Number of consecutive positions within the order claimed at once. */
+#define ORDER_BATCH 16
+
+/* Maps position <k> within the selected order to the index of the chunk
+ * to be processed at this position. */
+static uint_fast64_t order_index(uint_fast64_t k) {
+   switch (tgs.order.kind) {
+      default: return k;
+      case order_reverse: return tgs.order.chunks - 1 - k;
+      case order_stride:
+      {
+         /* Visit every chunk with the same remainder modulo the stride
+          * before advancing to the next remainder. */
+         uint_fast64_t const full= tgs.order.chunks / tgs.order.stride;
+         uint_fast64_t const longer= tgs.order.chunks % tgs.order.stride;
+         if (k < longer * (full + 1)) {
+            return k / (full + 1) + k % (full + 1) * tgs.order.stride;
+         }
+         k-= longer * (full + 1);
+         return longer + k / full + k % full * tgs.order.stride;
+      }
+      case order_random:
+      {
+         /* A Feistel network is a permutation of all numbers with
+          * 2 * half_bits bits. Apply it repeatedly until the result is
+          * within range ("cycle walking"), which keeps it a permutation. */
+         unsigned const h= tgs.order.half_bits;
+         uint_fast64_t const mask= ((uint_fast64_t)1 << h) - 1;
+         do {
+            uint_fast64_t l= k >> h, r= k & mask;
+            unsigned i;
+            for (i= 0; i < (unsigned)DIM(tgs.order.keys); ++i) {
+               uint_fast64_t state= r ^ tgs.order.keys[i], t= r;
+               r= (l ^ next_random(&state)) & mask;
+               l= t;
+            }
+            k= l << h | r;
+         } while (k >= tgs.order.chunks);
+         return k;
+      }
+   }
+}
+
+static void *ordered_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t *buffer;
+   struct latency_histogram *latency;
+   uint_fast64_t differences= 0, first_difference= 0;
+   int const writing= tgs.mode == mode_write;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   buffer= calloc_c5(tgs.order.chunk, 1);
+   latency= calloc_c5(1, sizeof *latency);
+   for (;;) {
+      uint_fast64_t k, stop;
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if ((stop= k= tgs.order.next) < tgs.order.chunks) {
+         stop= tgs.order.chunks - k < ORDER_BATCH
+            ? tgs.order.chunks : k + ORDER_BATCH
+         ;
+         tgs.order.next= stop;
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (k >= tgs.order.chunks) break;
+      for (; k < stop; ++k) {
+         uint_fast64_t pos= order_index(k) * tgs.order.chunk;
+         size_t size= tgs.order.chunk, done;
+         if (tgs.length - pos < size) size= (size_t)(tgs.length - pos);
+         pos+= tgs.start_pos;
+         if (writing) generate_data(buffer, size, pos);
+         for (done= 0; done < size; ) {
+            ssize_t did;
+            size_t chunk= throttle_c1(size - done);
+            off_t const offset= (off_t)(pos + done);
+            uint_fast64_t started= monotonic_ns();
+            did= writing
+               ?  pwrite(tgs.order.fd, buffer + done, chunk, offset)
+               :  pread(tgs.order.fd, buffer + done, chunk, offset)
+            ;
+            started= monotonic_ns() - started;
+            if (did <= 0) {
+               if (did == -1 && errno == EINTR) continue;
+               (void)fprintf(
+                     stderr
+                  ,  "%s error at byte offset %" PRIuFAST64 ": %s\n"
+                  ,  writing ? "Write" : "Read", pos + done
+                  ,  did ? strerror(errno) : "End of data"
+               );
+               error_c1(rc, writing ? msg_write_error : "Read error!");
+            }
+            record_latency(latency, started);
+            warn_about_stalls(pos + done, (size_t)did, started);
+            done+= (size_t)did;
+         }
+         if (!writing && xor_data(buffer, size, pos)) {
+            size_t i;
+            for (i= 0; i < size; ++i) {
+               if (
+                     buffer[i]
+                  && (!differences++ || pos + i < first_difference)
+               ) {
+                  first_difference= pos + i;
+               }
+            }
+         }
+      }
+   }
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   merge_latencies(&tgs.latency, latency);
+   if (differences) {
+      if (!tgs.num_errors || first_difference < tgs.first_error_pos) {
+         tgs.first_error_pos= first_difference;
+      }
+      tgs.num_errors+= differences;
+   }
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Writes or verifies the range starting at the starting offset in
+ * chunks of tgs.order.chunk bytes, processing the chunks in the order
+ * selected by tgs.order.kind. The data of every chunk only depends on its
+ * offset, so any order can verify the output of any other order. */
+static void ordered_mode_c1(unsigned threads) {
+   int const writing= tgs.mode == mode_write;
+   set_range_length_c1(tgs.order.fd= writing ? STDOUT_FILENO : STDIN_FILENO
+      , writing
+   );
+   tgs.order.chunks= CEIL_DIV(tgs.length, tgs.order.chunk);
+   if (tgs.order.kind == order_random) {
+      pearnd_offset po;
+      uint8_t key[sizeof tgs.order.keys];
+      unsigned i;
+      /* Derive the permutation from the seed. */
+      pearnd_seek(&po, 0);
+      pearnd_generate(key, sizeof key, &po);
+      for (i= (unsigned)sizeof key; i--; ) {
+         tgs.order.keys[i / 8]= tgs.order.keys[i / 8] << 8 | key[i];
+      }
+      while (
+         tgs.order.half_bits < 32
+         && tgs.order.chunks - 1 >> tgs.order.half_bits * 2
+      ) {
+         ++tgs.order.half_bits;
+      }
+   }
+   if (tgs.throttle.rate) init_throttle_c1(tgs.blksz, tgs.order.chunk);
+   {
+      static char const *const names[]= {
+         "sequential", "reverse", "strided", "pseudo-random permutation"
+      };
+      fprintf_c1(
+            stderr
+         ,  "Starting %s offset: %" PRIuFAST64 " bytes\n"
+            "size of the range: %" PRIuFAST64 " bytes\n"
+            "size of chunks: %zu bytes\n"
+            "order of chunks: %s\n"
+         ,  writing ? "output" : "input", tgs.start_pos, tgs.length
+         ,  tgs.order.chunk, names[tgs.order.kind]
+      );
+   }
+   if (tgs.order.kind == order_stride) {
+      fprintf_c1(
+            stderr, "stride: %" PRIuFAST64 " chunks\n", tgs.order.stride
+      );
+   }
+   fprintf_c1(
+         stderr
+      ,  "I/O threads: %u\n"
+         "\n%s PRNG data %s...\n"
+      ,  threads
+      ,  writing ? "writing" : "reading"
+      ,  writing ? "to standard output" : "from standard input"
+   );
+   report_times_c5();
+   {
+      uint_fast64_t started= monotonic_ns();
+      run_threads_c1(threads, &ordered_thread);
+      started= monotonic_ns() - started;
+      fprintf_c1(
+            stderr
+         ,  "\n"
+            "%s complete!\n"
+            "\n"
+            "Total bytes %s: %" PRIuFAST64 "\n"
+            "Average throughput: %.0f bytes per second\n"
+         ,  writing ? "Writing" : "Verification"
+         ,  writing ? "written" : "verified", tgs.length
+         ,  tgs.length * 1e9 / (started ? started : 1)
+      );
+   }
+   if (!writing) {
+      fprintf_c1(
+         stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+         , tgs.num_errors
+      );
+      if (tgs.num_errors) {
+         fprintf_c1(
+               stderr
+            ,  "First difference at byte offset %" PRIuFAST64 "\n"
+            ,  tgs.first_error_pos
+         );
+      }
+   }
+   fprintf_c1(
+      stderr, "I/O requests: %" PRIuFAST64 ", ", tgs.latency.requests
+   );
+   report_latencies(&tgs.latency);
+   fprintf_c1(stderr, "\n");
+   if (tgs.num_errors) ERROR_C1("Differences have been found!");
+}
+
+/* Size of the parts of the file mapped by the threads of mapped_mode_c1()
+ * one at a time. */
+#define MAPPED_CHUNK_SIZE (UINT32_C(8) << 20)
+
+/* Reserves disk space for <size> bytes at byte offset <pos> of the file
+ * written by mapped_mode_c1(), so that storing into the mapping cannot fail
+ * later. Returns how many of those bytes could be reserved before the
+ * filesystem became full. */
+static size_t reserve_mapped_c1(uint_fast64_t pos, size_t size) {
+   size_t reserved= 0, n= size;
+   while (reserved < size && n) {
+      if (!fallocate(tgs.mapped.fd, 0, (off_t)(pos + reserved), (off_t)n)) {
+         reserved+= n;
+         if (n > size - reserved) n= size - reserved;
+         continue;
+      }
+      switch (errno) {
+         case EINTR: continue;
+         case ENOSPC: case EDQUOT: case EFBIG: break;
+         case EOPNOTSUPP:
+            ERROR_C1("-M requires a filesystem supporting fallocate()!");
+            break; /* Not reached. */
+         default:
+            (void)fprintf(
+                  stderr
+               ,  "Could not allocate space at byte offset %" PRIuFAST64
+                  ": %s\n"
+               ,  pos + reserved, strerror(errno)
+            );
+            ERROR_C1(msg_write_error);
+      }
+      /* Try again with less, until not even a single block fits. */
+      n= n / 2 / tgs.blksz * tgs.blksz;
+   }
+   return reserved;
+}
+
+/* Claims chunks of the file one at a time, maps them and generates the
+ * data directly into the mapping, or compares the read-only mapping with
+ * the expected data. */
+static void *mapped_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t expected[COMPARE_PIECE_SIZE];
+   uint_fast64_t differences= 0, first_difference= 0;
+   int const writing= tgs.mode == mode_write;
+   size_t const page= (size_t)sysconf(_SC_PAGESIZE);
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   for (;;) {
+      uint_fast64_t pos;
+      size_t size= MAPPED_CHUNK_SIZE, offset, done;
+      uint8_t *map;
+      int claimed;
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      /* Other threads may lower tgs.mapped.end once the mutex has been
+       * unlocked, so remember whether the chunk has been claimed. */
+      if (claimed= (pos= tgs.mapped.next) < tgs.mapped.end) {
+         if (tgs.mapped.end - pos < size) size= (size_t)(tgs.mapped.end - pos);
+         tgs.mapped.next+= size;
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (!claimed) break;
+      if (writing) {
+         size_t const reserved= reserve_mapped_c1(pos, size);
+         if (reserved < size) {
+            /* The filesystem is full. Nothing beyond will be claimed. */
+            pthread_mutex_lock_c1(&tgs.workers_mutex);
+            if (pos + reserved < tgs.mapped.end) {
+               tgs.mapped.end= pos + reserved;
+            }
+            pthread_mutex_unlock_c1(&tgs.workers_mutex);
+            if (!(size= reserved)) break;
+         }
+      }
+      /* Mappings must start at a page boundary. */
+      offset= (size_t)(pos % page);
+      if (
+         (
+            map= mmap(
+                  0, offset + size, writing ? PROT_WRITE : PROT_READ
+               ,  MAP_SHARED, tgs.mapped.fd, (off_t)(pos - offset)
+            )
+         ) == MAP_FAILED
+      ) {
+         ERROR_C1("Could not map the file into memory!");
+      }
+      if (writing) {
+         generate_data(map + offset, size, pos);
+      } else {
+         (void)madvise(map, offset + size, MADV_SEQUENTIAL);
+         for (done= 0; done < size; ) {
+            uint8_t const *have;
+            size_t n, i;
+            /* Skip matching data without generating it into memory. */
+            if (
+                  (
+                     done+= compare_data(
+                        map + offset + done, size - done, pos + done
+                     )
+                  )
+               == size
+            ) {
+               break;
+            }
+            /* Count the differences within the next piece. */
+            have= map + offset + done;
+            if ((n= size - done) > sizeof expected) n= sizeof expected;
+            generate_data(expected, n, pos + done);
+            for (i= 0; i < n; ++i) {
+               if (
+                     have[i] != expected[i]
+                  && (!differences++ || pos + done + i < first_difference)
+               ) {
+                  first_difference= pos + done + i;
+               }
+            }
+            done+= n;
+         }
+      }
+      if (munmap(map, offset + size)) ERROR_C1(msg_exotic_error);
+      /* Let the kernel write the chunk back while we go on. */
+      if (writing) sync_file_range_c1(pos, pos + size, SYNC_FILE_RANGE_WRITE);
+   }
+   if (differences) {
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if (!tgs.num_errors || first_difference < tgs.first_error_pos) {
+         tgs.first_error_pos= first_difference;
+      }
+      tgs.num_errors+= differences;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   }
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Writes or verifies a regular file through memory mappings rather than
+ * write() or read(), so the data is never copied between a buffer and the
+ * page cache. When writing, the range ends where the filesystem is full
+ * unless set by -L. */
+static void mapped_mode_c1(unsigned threads) {
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   int const writing= tgs.mode == mode_write;
+   int const fd= writing ? STDOUT_FILENO : STDIN_FILENO;
+   uint_fast64_t bytes;
+   {
+      struct stat st;
+      if (fstat(fd, &st)) ERROR_C1(msg_exotic_error);
+      if (!S_ISREG(st.st_mode)) ERROR_C1("-M requires a regular file!");
+   }
+   if (writing) {
+      struct fd_resource *r= malloc_c1(sizeof *r);
+      r->saved= rc->rlist; r->dtor= &fd_dtor; rc->rlist= &r->dtor;
+      /* A shared writable mapping needs read access, too. */
+      if ((tgs.mapped.fd= fd_for_access(fd, O_RDWR, 0)) == -1) {
+         r->fd= -1;
+         ERROR_C1("Could not open standard output for reading and writing!");
+      }
+      r->fd= tgs.mapped.fd != fd ? tgs.mapped.fd : -1;
+      if (!tgs.length) tgs.length= (uint_fast64_t)INT64_MAX - tgs.start_pos;
+   } else {
+      set_range_length_c1(tgs.mapped.fd= fd, 0);
+   }
+   tgs.mapped.next= tgs.start_pos;
+   tgs.mapped.end= tgs.start_pos + tgs.length;
+   fprintf_c1(
+         stderr
+      ,  "Starting %s offset: %" PRIuFAST64 " bytes\n"
+         "size of mapped chunks: %u bytes\n"
+         "PRNG worker threads: %u\n"
+      ,  writing ? "output" : "input", tgs.start_pos
+      ,  (unsigned)MAPPED_CHUNK_SIZE, threads
+   );
+   if (tgs.compressible) {
+      fprintf_c1(
+            stderr
+         ,  "compressible bytes in every %u byte unit: %zu\n"
+         ,  (unsigned)COMPRESSIBLE_UNIT, tgs.compressible
+      );
+   }
+   fprintf_c1(
+         stderr
+      ,  "\n%s PRNG data %s via memory mappings...\n"
+      ,  writing ? "writing" : "reading"
+      ,  writing ? "to standard output" : "from standard input"
+   );
+   report_times_c5();
+   {
+      uint_fast64_t started= monotonic_ns();
+      run_threads_c1(threads, &mapped_thread);
+      bytes= tgs.mapped.end - tgs.start_pos;
+      if (writing) {
+         /* Drop whatever chunks beyond a full filesystem did fit. */
+         if (
+               tgs.mapped.end < tgs.start_pos + tgs.length
+            && ftruncate(tgs.mapped.fd, (off_t)tgs.mapped.end)
+         ) {
+            ERROR_C1(msg_write_error);
+         }
+         if (fdatasync(tgs.mapped.fd)) ERROR_C1(msg_write_error);
+      }
+      started= monotonic_ns() - started;
+      fprintf_c1(
+            stderr
+         ,  "\n"
+            "%s complete!\n"
+            "\n"
+            "%s stopped at byte offset %" PRIuFAST64 "!\n"
+            "(%s did start at byte offset %" PRIuFAST64 ")\n"
+            "Total bytes %s: %" PRIuFAST64 "\n"
+            "Average throughput: %.0f bytes per second\n"
+         ,  writing ? "Writing" : "Verification"
+         ,  writing ? "Output" : "Input", tgs.mapped.end
+         ,  writing ? "Output" : "Input", tgs.start_pos
+         ,  writing ? "written" : "verified", bytes
+         ,  bytes * 1e9 / (started ? started : 1)
+      );
+   }
+   if (!writing) {
+      fprintf_c1(
+         stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+         , tgs.num_errors
+      );
+      if (tgs.num_errors) {
+         fprintf_c1(
+               stderr
+            ,  "First difference at byte offset %" PRIuFAST64 "\n"
+            ,  tgs.first_error_pos
+         );
+      }
+   }
+   release_to_c1(rc, marker);
+   if (tgs.num_errors) ERROR_C1("Differences have been found!");
+}
+
+/* Claims the next segment within the window, and writes it with pwrite()
+ * after generating it, or reads it with pread() and verifies it. A short
+ * transfer ends the range for all threads. */
+static void *parallel_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t *buffer;
+   struct latency_histogram *latency;
+   int *mutex_procured;
+   uint_fast64_t differences= 0, first_difference= 0;
+   int const writing= tgs.mode == mode_write;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   buffer= aligned_alloc_c5(tgs.blksz, tgs.parallel.segment);
+   latency= calloc_c5(1, sizeof *latency);
+   mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
+   for (;;) {
+      uint_fast64_t k, pos;
+      size_t size= tgs.parallel.segment, done;
+      int claimed;
+      pthread_mutex_lock_c1(&tgs.workers_mutex); *mutex_procured= 1;
+      for (;;) {
+         pos= tgs.start_pos + (k= tgs.parallel.next) * size;
+         if (
+               pos >= tgs.parallel.end
+            || k - tgs.parallel.oldest < tgs.parallel.window
+         ) {
+            break;
+         }
+         pthread_cond_wait_c1(&tgs.workers_wakeup_call, &tgs.workers_mutex);
+      }
+      /* Other threads may lower tgs.parallel.end once the mutex has been
+       * unlocked, so remember whether segment <k> has been claimed. */
+      if (claimed= pos < tgs.parallel.end) {
+         tgs.parallel.next= k + 1;
+         if (tgs.parallel.end - pos < size) {
+            size= (size_t)(tgs.parallel.end - pos);
+         }
+      }
+      *mutex_procured= 0; pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (!claimed) break;
+      if (writing) generate_data(buffer, size, pos);
+      for (done= 0; done < size; ) {
+         ssize_t did;
+         size_t chunk= throttle_c1(size - done);
+         off_t const offset= (off_t)(pos + done);
+         uint_fast64_t started= monotonic_ns();
+         did= writing
+            ?  pwrite(tgs.parallel.fd, buffer + done, chunk, offset)
+            :  pread(tgs.parallel.fd, buffer + done, chunk, offset)
+         ;
+         started= monotonic_ns() - started;
+         if (did <= 0) {
+            if (!did) break; /* End of the device or input. */
+            switch (errno) {
+               case EINTR: continue;
+               case ENOSPC: case EDQUOT: case EFBIG:
+                  if (writing) break;
+                  /* Fall through. */
+               default:
+                  (void)fprintf(
+                        stderr
+                     ,  "%s error at byte offset %" PRIuFAST64 ": %s\n"
+                     ,  writing ? "Write" : "Read", pos + done
+                     ,  strerror(errno)
+                  );
+                  error_c1(rc, writing ? msg_write_error : "Read error!");
+            }
+            break; /* The filesystem is full. */
+         }
+         record_latency(latency, started);
+         warn_about_stalls(pos + done, (size_t)did, started);
+         done+= (size_t)did;
+      }
+      if (!writing && xor_data(buffer, done, pos)) {
+         size_t i;
+         for (i= 0; i < done; ++i) {
+            if (
+                  buffer[i]
+               && (!differences++ || pos + i < first_difference)
+            ) {
+               first_difference= pos + i;
+            }
+         }
+      }
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      /* Nothing beyond a short transfer will be claimed any more. */
+      if (done < size && pos + done < tgs.parallel.end) {
+         tgs.parallel.end= pos + done;
+      }
+      tgs.parallel.finished[k % tgs.parallel.window]= 1;
+      while (
+            tgs.parallel.oldest < tgs.parallel.next
+         && tgs.parallel.finished[tgs.parallel.oldest % tgs.parallel.window]
+      ) {
+         tgs.parallel.finished[tgs.parallel.oldest++ % tgs.parallel.window]=
+            0
+         ;
+      }
+      pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   }
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   merge_latencies(&tgs.latency, latency);
+   if (differences) {
+      if (!tgs.num_errors || first_difference < tgs.first_error_pos) {
+         tgs.first_error_pos= first_difference;
+      }
+      tgs.num_errors+= differences;
+   }
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Writes or verifies a regular file or block device by letting every
+ * thread transfer its own segments with pwrite() or pread(), so that the
+ * device sees as many concurrent requests as there are threads. When
+ * writing a regular file, the range ends where the filesystem is full
+ * unless set by -L. */
+static void parallel_mode_c1(unsigned threads) {
+   int const writing= tgs.mode == mode_write;
+   int const fd= writing ? STDOUT_FILENO : STDIN_FILENO;
+   uint_fast64_t bytes;
+   {
+      struct stat st;
+      if (fstat(fd, &st)) ERROR_C1(msg_exotic_error);
+      if (writing && S_ISREG(st.st_mode) && !tgs.length) {
+         tgs.length= (uint_fast64_t)INT64_MAX - tgs.start_pos;
+      } else {
+         set_range_length_c1(fd, writing);
+      }
+   }
+   tgs.parallel.fd= fd;
+   tgs.parallel.segment=
+      CEIL_DIV(PARALLEL_SEGMENT_SIZE, tgs.blksz) * tgs.blksz
+   ;
+   tgs.parallel.window= threads * PARALLEL_WINDOW;
+   tgs.parallel.finished= calloc_c5(tgs.parallel.window, 1);
+   tgs.parallel.end= tgs.start_pos + tgs.length;
+   if (tgs.throttle.rate) init_throttle_c1(tgs.blksz, tgs.parallel.segment);
+   fprintf_c1(
+         stderr
+      ,  "Starting %s offset: %" PRIuFAST64 " bytes\n"
+         "size of segments: %zu bytes\n"
+         "segments in flight: at most %u\n"
+         "I/O threads: %u\n"
+      ,  writing ? "output" : "input", tgs.start_pos
+      ,  tgs.parallel.segment, tgs.parallel.window, threads
+   );
+   if (tgs.compressible) {
+      fprintf_c1(
+            stderr
+         ,  "compressible bytes in every %u byte unit: %zu\n"
+         ,  (unsigned)COMPRESSIBLE_UNIT, tgs.compressible
+      );
+   }
+   fprintf_c1(
+         stderr
+      ,  "\n%s PRNG data %s...\n"
+      ,  writing ? "writing" : "reading"
+      ,  writing ? "to standard output" : "from standard input"
+   );
+   report_times_c5();
+   {
+      uint_fast64_t started= monotonic_ns();
+      run_threads_c1(threads, &parallel_thread);
+      bytes= tgs.parallel.end - tgs.start_pos;
+      if (writing) {
+         struct stat st;
+         if (fstat(fd, &st)) ERROR_C1(msg_exotic_error);
+         /* Drop whatever segments beyond a full filesystem did fit. */
+         if (
+               S_ISREG(st.st_mode)
+            && tgs.parallel.end < tgs.start_pos + tgs.length
+            && ftruncate(fd, (off_t)tgs.parallel.end)
+         ) {
+            ERROR_C1(msg_write_error);
+         }
+         if (fdatasync(fd)) ERROR_C1(msg_write_error);
+      }
+      started= monotonic_ns() - started;
+      fprintf_c1(
+            stderr
+         ,  "\n"
+            "%s complete!\n"
+            "\n"
+            "%s stopped at byte offset %" PRIuFAST64 "!\n"
+            "(%s did start at byte offset %" PRIuFAST64 ")\n"
+            "Total bytes %s: %" PRIuFAST64 "\n"
+            "Average throughput: %.0f bytes per second\n"
+         ,  writing ? "Writing" : "Verification"
+         ,  writing ? "Output" : "Input", tgs.parallel.end
+         ,  writing ? "Output" : "Input", tgs.start_pos
+         ,  writing ? "written" : "verified", bytes
+         ,  bytes * 1e9 / (started ? started : 1)
+      );
+   }
+   if (!writing) {
+      fprintf_c1(
+         stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+         , tgs.num_errors
+      );
+      if (tgs.num_errors) {
+         fprintf_c1(
+               stderr
+            ,  "First difference at byte offset %" PRIuFAST64 "\n"
+            ,  tgs.first_error_pos
+         );
+      }
+   }
+   fprintf_c1(
+      stderr, "I/O requests: %" PRIuFAST64 ", ", tgs.latency.requests
+   );
+   report_latencies(&tgs.latency);
+   fprintf_c1(stderr, "\n");
+   if (tgs.num_errors) ERROR_C1("Differences have been found!");
+}
+
+/* Claims chunks of either region in the ratio set by -R, as long as both
+ * regions have chunks left. Reads and verifies the chunks of region A, and
+ * generates and writes those of region B. */
+static void *mixed_thread(void *unused_dummy) {
+   r4g *rc;
+   uint8_t *buffer;
+   struct latency_histogram *latency;
+   uint_fast64_t bytes[2]= {0, 0}, last_ns[2]= {0, 0};
+   uint_fast64_t differences= 0, first_difference= 0;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   buffer= aligned_alloc_c5(tgs.blksz, tgs.order.chunk);
+   latency= calloc_c5(DIM(tgs.mixed.dirs), sizeof *latency);
+   for (;;) {
+      struct mixed_direction *d= tgs.mixed.dirs;
+      int writing;
+      uint_fast64_t pos;
+      size_t size= tgs.order.chunk, done;
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      if (d[0].next < d[0].end && d[1].next < d[1].end) {
+         writing=
+                  d[0].requests * 100
+               >= tgs.mixed.read_percent
+                  * (d[0].requests + d[1].requests + 1)
+         ;
+      } else {
+         writing= d[0].next >= d[0].end;
+      }
+      d+= writing;
+      if ((pos= d->next) < d->end) {
+         if (d->end - pos < size) size= (size_t)(d->end - pos);
+         d->next+= size;
+         ++d->requests;
+      }
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (pos >= d->end) break;
+      if (writing) generate_data(buffer, size, pos);
+      for (done= 0; done < size; ) {
+         ssize_t did;
+         size_t chunk= throttle_c1(size - done);
+         off_t const offset= (off_t)(pos + done);
+         uint_fast64_t started= monotonic_ns();
+         did= writing
+            ?  pwrite(tgs.mixed.fd, buffer + done, chunk, offset)
+            :  pread(tgs.mixed.fd, buffer + done, chunk, offset)
+         ;
+         started= monotonic_ns() - started;
+         if (did <= 0) {
+            if (did == -1 && errno == EINTR) continue;
+            (void)fprintf(
+                  stderr
+               ,  "%s error at byte offset %" PRIuFAST64 ": %s\n"
+               ,  writing ? "Write" : "Read", pos + done
+               ,  did ? strerror(errno) : "End of data"
+            );
+            error_c1(rc, writing ? msg_write_error : "Read error!");
+         }
+         record_latency(&latency[writing], started);
+         warn_about_stalls(pos + done, (size_t)did, started);
+         done+= (size_t)did;
+      }
+      if (!writing && xor_data(buffer, size, pos)) {
+         size_t i;
+         for (i= 0; i < size; ++i) {
+            if (
+                  buffer[i]
+               && (!differences++ || pos + i < first_difference)
+            ) {
+               first_difference= pos + i;
+            }
+         }
+      }
+      bytes[writing]+= size;
+      last_ns[writing]= monotonic_ns();
+   }
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   {
+      unsigned i;
+      for (i= (unsigned)DIM(tgs.mixed.dirs); i--; ) {
+         struct mixed_direction *d= &tgs.mixed.dirs[i];
+         merge_latencies(&d->latency, &latency[i]);
+         d->bytes+= bytes[i];
+         if (last_ns[i] > d->last_ns) d->last_ns= last_ns[i];
+      }
+   }
+   if (differences) {
+      if (!tgs.num_errors || first_difference < tgs.first_error_pos) {
+         tgs.first_error_pos= first_difference;
+      }
+      tgs.num_errors+= differences;
+   }
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
+
+/* Verifies region A of -L bytes at the starting offset, which must have
+ * been written with the same seed before, while writing region B directly
+ * following it. All threads and their buffers serve both directions. */
+static void mixed_mode_c1(unsigned threads) {
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   uint_fast64_t const region_a= tgs.length;
+   uint_fast64_t started;
+   if (!region_a) ERROR_C1("The size of region A must be set with -L!");
+   if (!tgs.mixed.region_b) tgs.mixed.region_b= region_a;
+   if (tgs.mixed.region_b > UINT_FAST64_MAX - region_a) {
+      ERROR_C1("Numeric overflow in region size!");
+   }
+   {
+      struct fd_resource *r= malloc_c1(sizeof *r);
+      r->saved= rc->rlist; r->dtor= &fd_dtor; rc->rlist= &r->dtor;
+      if (
+            (tgs.mixed.fd= fd_for_access(STDIN_FILENO, O_RDWR, 0))
+         == -1
+      ) {
+         r->fd= -1;
+         ERROR_C1("Could not open standard input for reading and writing!");
+      }
+      r->fd= tgs.mixed.fd != STDIN_FILENO ? tgs.mixed.fd : -1;
+   }
+   tgs.length= region_a + tgs.mixed.region_b;
+   set_range_length_c1(tgs.mixed.fd, 1);
+   if (tgs.length < region_a + tgs.mixed.region_b) {
+      ERROR_C1("Region B does not fit after region A!");
+   }
+   {
+      /* A regular file may grow by writing region B, but region A must
+       * already exist in order to be verified. */
+      struct stat st;
+      if (fstat(tgs.mixed.fd, &st)) ERROR_C1(msg_exotic_error);
+      if (
+            S_ISREG(st.st_mode)
+         && (uint_fast64_t)st.st_size < tgs.start_pos + region_a
+      ) {
+         ERROR_C1("Region A extends beyond the end of the file!");
+      }
+   }
+   if (!tgs.order.chunk) {
+      tgs.order.chunk= CEIL_DIV(MIXED_CHUNK_SIZE, tgs.blksz) * tgs.blksz;
+   }
+   tgs.mixed.dirs[0].next= tgs.start_pos;
+   tgs.mixed.dirs[1].next= tgs.mixed.dirs[0].end= tgs.start_pos + region_a;
+   tgs.mixed.dirs[1].end= tgs.mixed.dirs[1].next + tgs.mixed.region_b;
+   if (tgs.throttle.rate) init_throttle_c1(tgs.blksz, tgs.order.chunk);
+   fprintf_c1(
+         stderr
+      ,  "Region A to be verified: %" PRIuFAST64 " bytes at byte offset %"
+         PRIuFAST64 "\n"
+         "Region B to be written: %" PRIuFAST64 " bytes at byte offset %"
+         PRIuFAST64 "\n"
+         "size of requests: %zu bytes\n"
+         "share of read requests: %u %%\n"
+         "I/O threads: %u\n"
+      ,  region_a, tgs.start_pos, tgs.mixed.region_b, tgs.mixed.dirs[1].next
+      ,  tgs.order.chunk, tgs.mixed.read_percent, threads
+   );
+   if (tgs.compressible) {
+      fprintf_c1(
+            stderr
+         ,  "compressible bytes in every %u byte unit: %zu\n"
+         ,  (unsigned)COMPRESSIBLE_UNIT, tgs.compressible
+      );
+   }
+   fprintf_c1(
+      stderr, "\nverifying region A and writing region B at once...\n"
+   );
+   report_times_c5();
+   started= monotonic_ns();
+   run_threads_c1(threads, &mixed_thread);
+   if (fdatasync(tgs.mixed.fd)) ERROR_C1(msg_write_error);
+   fprintf_c1(stderr, "\nMixed test complete!\n\n");
+   {
+      static char const *const names[]= {"Read", "Write"};
+      unsigned i;
+      for (i= 0; i < (unsigned)DIM(tgs.mixed.dirs); ++i) {
+         struct mixed_direction const *d= &tgs.mixed.dirs[i];
+         uint_fast64_t const ns=
+            d->last_ns > started ? d->last_ns - started : 1
+         ;
+         fprintf_c1(
+               stderr
+            ,  "%s requests: %" PRIuFAST64 ", bytes: %" PRIuFAST64
+               ", %.0f bytes per second, "
+            ,  names[i], d->latency.requests, d->bytes, d->bytes * 1e9 / ns
+         );
+         report_latencies(&d->latency);
+         fprintf_c1(stderr, "\n");
+      }
+   }
+   fprintf_c1(
+      stderr, "Different bytes encountered: %" PRIuFAST64 "\n"
+      , tgs.num_errors
+   );
+   if (tgs.num_errors) {
+      fprintf_c1(
+            stderr
+         ,  "First difference at byte offset %" PRIuFAST64 "\n"
+         ,  tgs.first_error_pos
+      );
+   }
+   release_to_c1(rc, marker);
+   if (tgs.num_errors) ERROR_C1("Differences have been found!");
+}
+
+/* Reads the next segment of input <in> and compares it against the
+ * reference data once that has been generated. */
+static void multi_reader(struct multi_input *in, int *mutex_procured) {
+   for (;;) {
+      uint_fast64_t const k= in->segment;
+      uint_fast64_t const pos= tgs.start_pos + k * MULTI_SEGMENT_SIZE;
+      size_t size= MULTI_SEGMENT_SIZE, got= 0;
+      uint_fast64_t differences= 0, first= 0;
+      if (tgs.length && tgs.length - (pos - tgs.start_pos) < size) {
+         size= (size_t)(tgs.length - (pos - tgs.start_pos));
+      }
+      assert(!*mutex_procured);
+      while (got < size) {
+         ssize_t did= read(in->fd, in->buffer + got, size - got);
+         if (did <= 0) {
+            if (!did) break;
+            if (errno == EINTR) continue;
+            in->error= errno;
+            break;
+         }
+         got+= (size_t)did;
+      }
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      *mutex_procured= 1;
+      if (got) {
+         uint8_t const *expected;
+         while (tgs.multi.ready[k % MULTI_RING_DEPTH] != k + 1) {
+            *mutex_procured= 0;
+            pthread_cond_wait_c1(
+               &tgs.workers_wakeup_call, &tgs.workers_mutex
+            );
+            *mutex_procured= 1;
+         }
+         *mutex_procured= 0;
+         pthread_mutex_unlock_c1(&tgs.workers_mutex);
+         /* The slot cannot be reused before we advance <in->segment>. */
+         expected= tgs.multi.ring
+            + (size_t)(k % MULTI_RING_DEPTH) * MULTI_SEGMENT_SIZE
+         ;
+         if (memcmp(in->buffer, expected, got)) {
+            size_t i;
+            for (i= 0; i < got; ++i) {
+               if (in->buffer[i] != expected[i] && !differences++) {
+                  first= pos + i;
+               }
+            }
+         }
+         pthread_mutex_lock_c1(&tgs.workers_mutex);
+         *mutex_procured= 1;
+      }
+      in->bytes+= got;
+      if (differences) {
+         if (!in->differences) in->first_difference= first;
+         in->differences+= differences;
+      }
+      if (got < size || in->error || tgs.length && in->bytes == tgs.length) {
+         in->done= 1;
+         in->ns= monotonic_ns() - tgs.multi.started_ns;
+         --tgs.multi.active;
+      } else {
+         ++in->segment;
+      }
+      {
+         uint_fast64_t oldest= UINT_FAST64_MAX;
+         unsigned i;
+         for (i= 0; i < tgs.multi.count; ++i) {
+            struct multi_input const *other= &tgs.multi.inputs[i];
+            if (!other->done && other->segment < oldest) {
+               oldest= other->segment;
+            }
+         }
+         tgs.multi.oldest= oldest;
+      }
+      /* Generators may be waiting for the ring slot we have released. */
+      pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
+      *mutex_procured= 0;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      if (in->done) break;
+   }
 }
 
-static void *calloc_c5(size_t num_elements, size_t element_size) {
-   struct mallocated_resource *r= malloc_c1(sizeof *r);
-   r4g *rc;
-   r->saved= (rc= r4g_c1())->rlist;
-   r->dtor= &mallocated_dtor; rc->rlist= &r->dtor;
-   if (!(r->buffer= calloc(num_elements, element_size))) {
-      error_c1(rc, msg_malloc_error);
+/* Generates the reference segments as far ahead of the slowest input as
+ * the ring permits, until all inputs are done. */
+static void multi_generator(int *mutex_procured) {
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   *mutex_procured= 1;
+   while (tgs.multi.active) {
+      uint_fast64_t const k= tgs.multi.next;
+      if (
+            k >= tgs.multi.oldest + MULTI_RING_DEPTH
+         || tgs.multi.segments && k >= tgs.multi.segments
+      ) {
+         *mutex_procured= 0;
+         pthread_cond_wait_c1(&tgs.workers_wakeup_call, &tgs.workers_mutex);
+         *mutex_procured= 1;
+         continue;
+      }
+      ++tgs.multi.next;
+      *mutex_procured= 0;
+      pthread_mutex_unlock_c1(&tgs.workers_mutex);
+      generate_data(
+            tgs.multi.ring
+            + (size_t)(k % MULTI_RING_DEPTH) * MULTI_SEGMENT_SIZE
+         ,  MULTI_SEGMENT_SIZE, tgs.start_pos + k * MULTI_SEGMENT_SIZE
+      );
+      pthread_mutex_lock_c1(&tgs.workers_mutex);
+      *mutex_procured= 1;
+      tgs.multi.ready[k % MULTI_RING_DEPTH]= k + 1;
+      pthread_cond_broadcast_c1(&tgs.workers_wakeup_call);
    }
-   return r->buffer;
+   *mutex_procured= 0;
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
 }
 
-struct report_times_static_resource {
-   struct timespec started;
-   r4g_dtor dtor, *saved;
-};
+static void *multi_thread(void *unused_dummy) {
+   r4g *rc;
+   int *workers_mutex_procured;
+   unsigned role;
+   (void)unused_dummy;
+   {
+      char const *error;
+      if (error= new_r4g_thread_context_c0()) return (void *)error;
+   }
+   rc= r4g_c1();
+   workers_mutex_procured= mutex_unlocker_c5(&tgs.workers_mutex);
+   pthread_mutex_lock_c1(&tgs.workers_mutex);
+   role= tgs.multi.roles++;
+   pthread_mutex_unlock_c1(&tgs.workers_mutex);
+   if (role < tgs.multi.count) {
+      multi_reader(&tgs.multi.inputs[role], workers_mutex_procured);
+   } else {
+      multi_generator(workers_mutex_procured);
+   }
+   release_c1(rc);
+   return (void *)rc->static_error_message;
+}
 
-static void report_times(char const *name, time_t seconds) {
+/* Verifies all inputs specified with -i against the same PRNG stream,
+ * using <threads> threads for generating the expected data just once and
+ * an additional reader thread for every input. Block devices are flushed
+ * first unless <never_flush>. */
+static void multi_verify_mode_c1(unsigned threads, int never_flush) {
+   r4g *rc= r4g_c1();
+   r4g_dtor *marker= rc->rlist;
+   uint_fast64_t total= 0;
+   unsigned i, failed= 0;
+   tgs.start_pos= tgs.pos;
+   if (tgs.length) {
+      tgs.multi.segments= CEIL_DIV(tgs.length, MULTI_SEGMENT_SIZE);
+   }
+   for (i= 0; i < tgs.multi.count; ++i) {
+      struct multi_input *in= &tgs.multi.inputs[i];
+      struct stat st;
+      {
+         struct fd_resource *r= malloc_c1(sizeof *r);
+         r->saved= rc->rlist; r->dtor= &fd_dtor; rc->rlist= &r->dtor;
+         if ((r->fd= in->fd= open(in->path, O_RDONLY)) == -1) {
+            (void)fprintf(stderr, "Cannot open '%s'!\n", in->path);
+            ERROR_C1("Could not open input!");
+         }
+      }
+      if (fstat(in->fd, &st)) ERROR_C1(msg_exotic_error);
+      if (
+         S_ISBLK(st.st_mode) && !never_flush && ioctl(in->fd, BLKFLSBUF) < 0
+      ) {
+         ERROR_C1("Unable to flush device buffer before starting operation!");
+      }
+      if (
+            tgs.start_pos
+         && lseek(in->fd, (off_t)tgs.start_pos, SEEK_SET) == (off_t)-1
+      ) {
+         (void)fprintf(stderr, "Cannot seek in '%s'!\n", in->path);
+         ERROR_C1("Could not reposition input to starting position!");
+      }
+      (void)posix_fadvise(in->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      in->buffer= calloc_c5(MULTI_SEGMENT_SIZE, 1);
+   }
+   tgs.multi.ring= calloc_c5(MULTI_RING_DEPTH, MULTI_SEGMENT_SIZE);
+   tgs.multi.active= tgs.multi.count;
    fprintf_c1(
          stderr
-      ,  "%s\t%lu seconds = %.1f minutes = %.2f hours\n"
-      ,  name
-      ,  (unsigned long)seconds
-      ,  seconds / 60.
-      ,  seconds / (60. * 60)
+      ,  "Starting input offset: %" PRIuFAST64 " bytes\n"
+         "inputs: %u\n"
+         "PRNG worker threads: %u\n"
+         "size of reference segments: %u bytes\n"
+         "number of segments in the reference ring: %u\n"
+      ,  tgs.start_pos, tgs.multi.count, threads
+      ,  (unsigned)MULTI_SEGMENT_SIZE, (unsigned)MULTI_RING_DEPTH
    );
-}
-
-static void report_times_dtor(r4g *rc) {
-   R4G_DEFINE_INIT_RPTR(struct report_times_static_resource, *r=, rc, dtor);
-   struct timespec real;
-   struct rusage ru;
-   rc->rlist= r->saved;
-   if (clock_gettime(CLOCK_MONOTONIC, &real) < 0) goto unlikely_error;
-   real.tv_sec-= r->started.tv_sec + (
-      real.tv_nsec < r->started.tv_nsec /* borrow */
+   if (tgs.compressible) {
+      fprintf_c1(
+            stderr
+         ,  "compressible bytes in every %u byte unit: %zu\n"
+         ,  (unsigned)COMPRESSIBLE_UNIT, tgs.compressible
+      );
+   }
+   fprintf_c1(stderr, "\nreading PRNG data from all inputs...\n");
+   report_times_c5();
+   tgs.multi.started_ns= monotonic_ns();
+   run_threads_c1(tgs.multi.count + threads, &multi_thread);
+   fprintf_c1(stderr, "\nVerification complete!\n\n");
+   for (i= 0; i < tgs.multi.count; ++i) {
+      struct multi_input const *in= &tgs.multi.inputs[i];
+      total+= in->bytes;
+      fprintf_c1(
+            stderr
+         ,  "%s: %" PRIuFAST64 " bytes verified at %.0f bytes per second,"
+            " %" PRIuFAST64 " different bytes\n"
+         ,  in->path, in->bytes, in->bytes * 1e9 / (in->ns ? in->ns : 1)
+         ,  in->differences
+      );
+      if (in->differences) {
+         fprintf_c1(
+               stderr
+            ,  "  first difference at byte offset %" PRIuFAST64 "\n"
+            ,  in->first_difference
+         );
+      }
+      if (in->error) {
+         fprintf_c1(
+               stderr, "  read error at byte offset %" PRIuFAST64 ": %s\n"
+            ,  tgs.start_pos + in->bytes, strerror(in->error)
+         );
+      }
+      if (in->differences || in->error) ++failed;
+   }
+   fprintf_c1(
+         stderr
+      ,  "Total bytes verified: %" PRIuFAST64 "\n"
+         "Reference data generated: %" PRIuFAST64 " bytes\n"
+      ,  total, tgs.multi.next * MULTI_SEGMENT_SIZE
    );
-   if (getrusage(RUSAGE_SELF, &ru) < 0) unlikely_error: ERROR_C1(0);
-   fprintf_c1(stderr, "\n");
-   report_times("real", real.tv_sec);
-   report_times("user", ru.ru_utime.tv_sec);
-   report_times("sys", ru.ru_stime.tv_sec);
+   release_to_c1(rc, marker);
+   if (failed) {
+      fprintf_c1(
+         stderr, "Inputs with differences or read errors: %u\n", failed
+      );
+      ERROR_C1("Differences have been found!");
+   }
 }
 
-#define CEIL_DIV(num, den) (((num) + (den) - 1) / (den))
-
 int main(int argc, char **argv) {
    static unsigned threads;
    static pthread_t *tid;
    static char *tvalid;
    static r4g m;
-   char const *argv0;
-   int never_flush= 0;
+   char const *argv0, *log_file= 0, *directory= 0, *map_file= 0;
+   char const *manifest_file= 0;
+   r4g_dtor *threads_marker;
+   int never_flush= 0, adaptive= 1, mixed_options= 0, stall_option= 0;
    (void)setlocale(LC_ALL, ""); /* Enable locale if supported. */
    {
       static struct error_reporting_static_resource r;
@@ -812,6 +4731,15 @@ int main(int argc, char **argv) {
          &m, "Could not set error-handling context for main thread!"
       );
    }
+   tgs.stall_ns= UINT64_C(5000) * 1000000u;
+   tgs.dir.file_size= UINT64_C(1) << 30;
+   tgs.dir.streams= 4;
+   tgs.iops.seconds= 10;
+   tgs.mixed.read_percent= 50;
+   tgs.iops.sizes[0]= 4096; tgs.iops.sizes[1]= 16384;
+   tgs.iops.sizes[2]= 65536; tgs.iops.num_sizes= 3;
+   tgs.iops.depths[0]= 1; tgs.iops.depths[1]= 4;
+   tgs.iops.depths[2]= 32; tgs.iops.num_depths= 3;
    {
       int optind;
       int be_nice= 1;
@@ -829,25 +4757,459 @@ int main(int argc, char **argv) {
                         )
                      )
                   ) {
-                     getopt_simplest_perror_missing_arg(opt);
-                     goto error_shown;
+                     missing_argument:
+                     getopt_simplest_perror_missing_arg(opt);
+                     goto error_shown;
+                  }
+                  {
+                     int converted;
+                     if (
+                           sscanf(
+                              optarg, "%u%n", &threads, &converted
+                           ) != 1
+                        || (size_t)converted != strlen(optarg)
+                     ) {
+                        error_c1(&m, "Invalid numeric option argument!");
+                     }
+                  }
+                  break;
+               case 'r':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  tgs.throttle.rate= atou64_scaled(optarg);
+                  break;
+               case 'W':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     int converted;
+                     if (
+                           sscanf(
+                                 optarg, "%u-%u%n"
+                              ,  &tgs.throttle.from_hour
+                              ,  &tgs.throttle.to_hour, &converted
+                           ) != 2
+                        || (size_t)converted != strlen(optarg)
+                        || tgs.throttle.from_hour > 24
+                        || tgs.throttle.to_hour > 24
+                     ) {
+                        error_c1(&m, "Invalid time window!");
+                     }
+                     /* Hour 24 is the same as hour 0 of the next day. */
+                     tgs.throttle.from_hour%= 24;
+                     tgs.throttle.to_hour%= 24;
+                  }
+                  break;
+               case 'l':
+                  if (
+                     !(
+                        log_file= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  break;
+               case 'e':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (
+                        !(tgs.tput.extent= atou64_scaled(optarg))
+                     || tgs.tput.extent > UINT_FAST64_MAX / 1000000000u
+                  ) {
+                     error_c1(&m, "Unsupported extent size!");
+                  }
+                  break;
+               case 'm':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  tgs.tput.min_rate= atou64_scaled(optarg);
+                  break;
+               case 'S':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (
+                        (tgs.stall_ns= atou64(optarg))
+                     >  UINT_FAST64_MAX / 1000000u
+                  ) {
+                     goto bad_time;
+                  }
+                  tgs.stall_ns*= 1000000u;
+                  stall_option= 1;
+                  break;
+               case 'P':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (
+                        !(tgs.progress.interval_ns= atou64(optarg))
+                     ||    tgs.progress.interval_ns
+                        >  UINT_FAST64_MAX / 1000000000u
+                  ) {
+                     bad_time: error_c1(&m, "Unsupported time interval!");
+                  }
+                  tgs.progress.interval_ns*= 1000000000u;
+                  break;
+               case 'd': case 'D':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     unsigned i;
+                     for (i= (unsigned)DIM(discard_kinds); i--; ) {
+                        if (!strcmp(optarg, discard_kinds[i].name)) break;
+                     }
+                     if (i == (unsigned)-1) {
+                        error_c1(&m, "Unsupported kind of discard!");
+                     }
+                     *(opt == 'd' ? &tgs.discard.pre : &tgs.discard.post)=
+                        i + 1
+                     ;
+                  }
+                  break;
+               case 'w':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (!(tgs.writeback.limit= atou64_scaled(optarg))) {
+                     error_c1(&m, "Dirty limit must not be zero!");
+                  }
+                  break;
+               case 'E':
+                  if (
+                     !(
+                        map_file= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  break;
+               case 'b': case 'q':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (opt == 'b') {
+                     unsigned i;
+                     tgs.iops.num_sizes= parse_list_c1(
+                        tgs.iops.sizes, (unsigned)DIM(tgs.iops.sizes), optarg
+                     );
+                     for (i= tgs.iops.num_sizes; i--; ) {
+                        if (
+                              tgs.iops.sizes[i] % 512
+                           || tgs.iops.sizes[i] > SIZE_MAX
+                        ) {
+                           error_c1(
+                                 &m
+                              ,  "Request sizes must be multiples of 512!"
+                           );
+                        }
+                     }
+                  } else {
+                     unsigned i;
+                     tgs.iops.num_depths= parse_list_c1(
+                           tgs.iops.depths, (unsigned)DIM(tgs.iops.depths)
+                        ,  optarg
+                     );
+                     for (i= tgs.iops.num_depths; i--; ) {
+                        if (tgs.iops.depths[i] > 1024) {
+                           error_c1(&m, "Queue depth is too large!");
+                        }
+                     }
+                  }
+                  break;
+               case 's':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (
+                        !(tgs.iops.seconds= atou64(optarg))
+                     || tgs.iops.seconds > UINT_FAST64_MAX / 1000000000u
+                  ) {
+                     goto bad_time;
+                  }
+                  break;
+               case 'L':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  tgs.length= atou64_scaled(optarg);
+                  break;
+               case 'o':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (!strcmp(optarg, "sequential")) {
+                     tgs.order.kind= order_sequential;
+                  } else if (!strcmp(optarg, "reverse")) {
+                     tgs.order.kind= order_reverse;
+                  } else if (!strcmp(optarg, "random")) {
+                     tgs.order.kind= order_random;
+                  } else if (!strncmp(optarg, "stride:", 7)) {
+                     tgs.order.kind= order_stride;
+                     if (!(tgs.order.stride= atou64(optarg + 7))) {
+                        error_c1(&m, "Stride must not be zero!");
+                     }
+                  } else {
+                     error_c1(&m, "Unsupported order!");
+                  }
+                  break;
+               case 'c':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     uint_fast64_t chunk= atou64_scaled(optarg);
+                     if (!chunk || chunk % 512 || chunk > SIZE_MAX) {
+                        error_c1(
+                           &m, "Chunk size must be a multiple of 512!"
+                        );
+                     }
+                     tgs.order.chunk= (size_t)chunk;
+                  }
+                  break;
+               case 'C':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     uint_fast64_t percent= atou64(optarg);
+                     if (percent > 99) {
+                        error_c1(&m, "Compressibility must be below 100%!");
+                     }
+                     tgs.compressible= (size_t)(
+                        percent * COMPRESSIBLE_UNIT / 100
+                     );
+                  }
+                  break;
+               case 'z':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (!(tgs.dir.file_size= atou64_scaled(optarg))) {
+                     error_c1(&m, "File size must not be zero!");
+                  }
+                  break;
+               case 'j':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
                   }
                   {
                      int converted;
                      if (
                            sscanf(
-                              optarg, "%u%n", &threads, &converted
+                              optarg, "%u%n", &tgs.dir.streams, &converted
                            ) != 1
                         || (size_t)converted != strlen(optarg)
+                        || !tgs.dir.streams
                      ) {
                         error_c1(&m, "Invalid numeric option argument!");
                      }
                   }
                   break;
+               case 'A': adaptive= 0; break;
                case 'N': be_nice= 0; break;
                case 'V': printf_c1("%s\n", VERSION_INFO); goto cleanup;
                case 'h': printf_c1(usage, argv0); goto cleanup;
                case 'F': never_flush= 1; break;
+               case 'x': tgs.stats.enabled= 1; break;
+               case 'H': tgs.perf.enabled= 1; break;
+               case 'M': tgs.mapped.enabled= 1; break;
+               case 'I': tgs.parallel.enabled= 1; break;
+               case 'B':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (!(tgs.mixed.region_b= atou64_scaled(optarg))) {
+                     error_c1(&m, "Region size must not be zero!");
+                  }
+                  mixed_options= 1;
+                  break;
+               case 'R':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     uint_fast64_t percent= atou64(optarg);
+                     if (percent > 100) {
+                        error_c1(&m, "Share of reads must be at most 100%!");
+                     }
+                     tgs.mixed.read_percent= (unsigned)percent;
+                  }
+                  mixed_options= 1;
+                  break;
+               case 'n': tgs.nt_stores= 1; break;
+               case 'T': tgs.stamps.enabled= 1; break;
+               case 'p':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  {
+                     unsigned i;
+                     for (i= (unsigned)DIM(pattern_kinds); i--; ) {
+                        if (!strcmp(optarg, pattern_kinds[i].name)) break;
+                     }
+                     if (i != (unsigned)-1) {
+                        tgs.pattern.kind= pattern_kinds[i].kind;
+                     } else {
+                        unsigned byte;
+                        /* sscanf() would also accept a sign or a single
+                         * digit. */
+                        if (
+                              strlen(optarg) != 4
+                           || strncmp(optarg, "0x", 2)
+                           || !isxdigit((unsigned char)optarg[2])
+                           || !isxdigit((unsigned char)optarg[3])
+                           || sscanf(optarg + 2, "%2x", &byte) != 1
+                        ) {
+                           error_c1(&m, "Unsupported pattern!");
+                        }
+                        tgs.pattern.kind.fill=
+                           byte * UINT64_C(0x0101010101010101)
+                        ;
+                     }
+                     /* There is no seed file, but -o random derives its
+                      * permutation from the PRNG. */
+                     pearnd_init(optarg, strlen(optarg));
+                     tgs.pattern.enabled= 1;
+                  }
+                  break;
+               case 'i':
+                  if (
+                     !(
+                        optarg= getopt_simplest_mand_arg(
+                           &optind, &optpos, argc, argv
+                        )
+                     )
+                  ) {
+                     goto missing_argument;
+                  }
+                  if (tgs.multi.count == DIM(tgs.multi.inputs)) {
+                     error_c1(&m, "Too many inputs!");
+                  }
+                  tgs.multi.inputs[tgs.multi.count++].path= optarg;
+                  break;
                default:
                   getopt_simplest_perror_opt(opt);
                   goto error_shown;
@@ -862,10 +5224,27 @@ int main(int argc, char **argv) {
          else if (!strcmp(cmd, "verify")) tgs.mode= mode_verify;
          else if (!strcmp(cmd, "compare")) tgs.mode= mode_compare;
          else if (!strcmp(cmd, "diff")) tgs.mode= mode_diff;
+         else if (!strcmp(cmd, "fill")) tgs.mode= mode_fill;
+         else if (!strcmp(cmd, "check")) tgs.mode= mode_check;
+         else if (!strcmp(cmd, "iops")) tgs.mode= mode_iops;
+         else if (!strcmp(cmd, "mixed")) tgs.mode= mode_mixed;
+         else if (!strcmp(cmd, "digest")) tgs.mode= mode_digest;
+         else if (!strcmp(cmd, "verify-digest")) {
+            tgs.mode= mode_verify_digest;
+         }
          else goto bad_arguments;
       }
-      if (optind == argc) goto bad_arguments;
-      load_seed(argv[optind++]);
+      if (tgs.mode == mode_digest || tgs.mode == mode_verify_digest) {
+         if (optind == argc) goto bad_arguments;
+         manifest_file= argv[optind++];
+      } else if (!tgs.pattern.enabled) {
+         if (optind == argc) goto bad_arguments;
+         load_seed(argv[optind++]);
+      }
+      if (tgs.mode == mode_fill || tgs.mode == mode_check) {
+         if (optind == argc) goto bad_arguments;
+         directory= argv[optind++];
+      }
       if (optind < argc) {
          tgs.pos= atou64(argv[optind++]);
       }
@@ -912,6 +5291,115 @@ int main(int argc, char **argv) {
          }
       }
    }
+   if (log_file || tgs.tput.min_rate) {
+      if (!tgs.tput.extent) tgs.tput.extent= UINT64_C(64) << 20;
+      {
+         static struct minimal_resource r;
+         r.saved= m.rlist; r.dtor= &slow_regions_dtor; m.rlist= &r.dtor;
+      }
+   } else {
+      tgs.tput.extent= 0;
+   }
+   if (log_file) {
+      struct FILE_mallocated_resource *f= malloc_c1(sizeof *f);
+      f->saved= m.rlist; f->dtor= &FILE_mallocated_dtor; m.rlist= &f->dtor;
+      if (!(f->handle= tgs.tput.log= fopen(log_file, "w"))) {
+         error_c1(&m, "Could not create throughput log file!");
+      }
+      fprintf_c1(tgs.tput.log, "offset,bytes,elapsed_ns,bytes_per_second\n");
+   }
+   if (map_file) {
+      if (
+            tgs.mode != mode_compare && tgs.mode != mode_diff
+         && tgs.mode != mode_verify
+      ) {
+         error_c1(
+            &m, "-E is only supported by 'verify', 'compare' and 'diff'!"
+         );
+      }
+      {
+         struct FILE_mallocated_resource *f= malloc_c1(sizeof *f);
+         f->saved= m.rlist; f->dtor= &FILE_mallocated_dtor;
+         m.rlist= &f->dtor;
+         if (!(f->handle= tgs.salvage.map= fopen(map_file, "w"))) {
+            error_c1(&m, "Could not create map file for unreadable data!");
+         }
+      }
+      fprintf_c1(tgs.salvage.map, "offset,bytes\n");
+      {
+         static struct minimal_resource r;
+         r.saved= m.rlist; r.dtor= &salvage_map_dtor; m.rlist= &r.dtor;
+      }
+      tgs.salvage.sector= 512;
+   }
+   if (mixed_options && tgs.mode != mode_mixed) {
+      error_c1(&m, "-B and -R are only supported by 'mixed'!");
+   }
+   if (tgs.stats.enabled && tgs.mode != mode_verify) {
+      error_c1(&m, "-x is only supported by 'verify'!");
+   }
+   if (tgs.nt_stores && (tgs.mode != mode_write || tgs.compressible)) {
+      error_c1(&m, "-n is only supported by 'write' without -C!");
+   }
+   if (tgs.pattern.enabled) {
+      if (tgs.compressible || tgs.nt_stores) {
+         error_c1(&m, "-p cannot be combined with -C or -n!");
+      }
+      if (manifest_file) {
+         error_c1(&m, "-p is not supported by the digest modes!");
+      }
+   }
+   if (tgs.stamps.enabled) {
+      if (tgs.compressible || tgs.nt_stores || tgs.pattern.enabled) {
+         error_c1(&m, "-T cannot be combined with -C, -n or -p!");
+      }
+      if (manifest_file) {
+         error_c1(&m, "-T is not supported by the digest modes!");
+      }
+   }
+   if (
+         tgs.perf.enabled && tgs.mode != mode_write && tgs.mode != mode_verify
+      && tgs.mode != mode_digest && tgs.mode != mode_verify_digest
+   ) {
+      error_c1(
+            &m
+         ,  "-H is only supported by 'write', 'verify', 'digest' and"
+            " 'verify-digest'!"
+      );
+   }
+   if (manifest_file) {
+      int const writing= tgs.mode == mode_digest;
+      {
+         struct FILE_mallocated_resource *f= malloc_c1(sizeof *f);
+         f->saved= m.rlist; f->dtor= &FILE_mallocated_dtor;
+         m.rlist= &f->dtor;
+         if (
+            !(
+               f->handle= tgs.digest.manifest= fopen(
+                  manifest_file, writing ? "w" : "r"
+               )
+            )
+         ) {
+            error_c1(&m, "Could not open manifest file!");
+         }
+      }
+      if (writing) {
+         if (!tgs.order.chunk) tgs.order.chunk= DIGEST_BLOCK_SIZE;
+         tgs.digest.block= tgs.order.chunk;
+         fprintf_c1(
+               tgs.digest.manifest, "# " MANIFEST_HEADER "\n"
+            ,  tgs.digest.block
+         );
+      } else if (
+            fscanf(
+                  tgs.digest.manifest, "# " MANIFEST_HEADER
+               ,  &tgs.digest.block
+            ) != 1
+         || !tgs.digest.block || tgs.digest.block % 512
+      ) {
+         error_c1(&m, "Invalid manifest!");
+      }
+   }
    /* Ignore SIGPIPE because we want it as a possible errno from write(). */
    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) goto unlikely_error;
    /* Preset global variables for interthread communication. */
@@ -930,6 +5418,59 @@ int main(int argc, char **argv) {
       r.saved= m.rlist; r.dtor= &pthread_cond_static_dtor;
       m.rlist= &r.dtor;
    }
+   if (pthread_cond_init(&tgs.workers_parking_lot, 0)) goto unlikely_error;
+   {
+      static struct pthread_cond_static_resource r;
+      r.cond= &tgs.workers_parking_lot;
+      r.saved= m.rlist; r.dtor= &pthread_cond_static_dtor;
+      m.rlist= &r.dtor;
+   }
+   if (pthread_mutex_init(&tgs.throttle.mutex, 0)) goto unlikely_error;
+   {
+      static struct pthread_mutex_static_resource r;
+      r.mutex= &tgs.throttle.mutex;
+      r.saved= m.rlist; r.dtor= &pthread_mutex_static_dtor;
+      m.rlist= &r.dtor;
+   }
+   if (directory) {
+      if (
+            tgs.writeback.limit || tgs.discard.pre || tgs.discard.post
+         || tgs.length
+      ) {
+         error_c1(
+            &m, "-w, -d, -D and -L are not supported for directories!"
+         );
+      }
+      if (tgs.tput.log || tgs.tput.min_rate || tgs.progress.interval_ns) {
+         error_c1(&m, "-l, -m and -P are not supported for directories!");
+      }
+      directory_mode_c1(directory);
+      goto finished;
+   }
+   if (tgs.multi.count) {
+      if (tgs.mode != mode_verify) {
+         error_c1(&m, "-i is only supported by 'verify'!");
+      }
+      if (
+            tgs.discard.post || tgs.throttle.rate || tgs.tput.log
+         || tgs.tput.min_rate || tgs.salvage.map || tgs.stats.enabled
+         || tgs.perf.enabled || tgs.mapped.enabled || tgs.parallel.enabled
+         || tgs.order.kind != order_sequential || tgs.writeback.limit
+         || stall_option || tgs.progress.interval_ns
+      ) {
+         error_c1(
+               &m
+            ,  "-D, -r, -l, -m, -E, -x, -H, -M, -I, -o, -w, -S and -P are"
+               " not supported with -i!"
+         );
+      }
+      {
+         unsigned const procs= available_processors_c1();
+         if (!threads || procs < threads) threads= procs;
+      }
+      multi_verify_mode_c1(threads, never_flush);
+      goto finished;
+   }
    /* Determine the best I/O block size, defaulting to the value preset
     * earlier. */
    {
@@ -944,6 +5485,49 @@ int main(int argc, char **argv) {
       ) {
          error_c1(&m, "Cannot examine file descriptor to be used for I/O!");
       }
+      if (tgs.discard.pre || tgs.discard.post) {
+         if (!S_ISBLK(st.st_mode)) {
+            error_c1(&m, "Discarding is only supported for block devices!");
+         }
+         if (tgs.mode == mode_write ? tgs.discard.post : tgs.discard.pre) {
+            error_c1(
+                  &m
+               ,  "Use -d only in write mode and -D only in the other modes!"
+            );
+         }
+         tgs.discard.fd= fd;
+      }
+      if (tgs.salvage.map) {
+         if (S_ISREG(st.st_mode)) {
+            tgs.salvage.end= (uint_fast64_t)st.st_size;
+         } else if (S_ISBLK(st.st_mode)) {
+            uint64_t bytes;
+            if (ioctl(fd, BLKGETSIZE64, &bytes) < 0) {
+               error_c1(&m, "Unable to determine block device size!");
+            }
+            tgs.salvage.end= bytes;
+         } else {
+            error_c1(
+                  &m
+               ,  "-E requires the input to be a regular file"
+                  " or a block device!"
+            );
+         }
+      }
+      if (tgs.writeback.limit) {
+         if (tgs.mode != mode_write) {
+            error_c1(&m, "-w is only supported in write mode!");
+         }
+         if (!S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode)) {
+            error_c1(
+                  &m
+               ,  "-w requires the output to be a regular file"
+                  " or a block device!"
+            );
+         }
+      }
+      /* Sparse files are verified without reading their holes. */
+      tgs.holes.enabled= tgs.mode == mode_verify && S_ISREG(st.st_mode);
       if (S_ISBLK(mode= st.st_mode)) {
          /* It's a block device. */
          {
@@ -952,6 +5536,7 @@ int main(int argc, char **argv) {
                error_c1(&m, "Unable to determine logical sector size!");
             }
             if ((size_t)logical > tgs.blksz) tgs.blksz= (size_t)logical;
+            if (tgs.salvage.map) tgs.salvage.sector= (size_t)logical;
          }
          {
             int physical;
@@ -997,6 +5582,7 @@ int main(int argc, char **argv) {
       }
       tgs.blksz= bmask;
    }
+   tgs.writeback.started= tgs.writeback.done= tgs.pos;
    if (tgs.start_pos= tgs.pos) {
       if (tgs.pos % tgs.blksz) {
          error_c1(
@@ -1033,6 +5619,16 @@ int main(int argc, char **argv) {
          if ((uint_fast64_t)pos != tgs.pos) goto seeking_did_not_work;
       }
    }
+   if (tgs.mode == mode_iops) {
+      if (
+            tgs.throttle.rate || tgs.discard.post || tgs.tput.log
+         || tgs.tput.min_rate || tgs.progress.interval_ns
+      ) {
+         error_c1(&m, "-r, -D, -l, -m and -P are not supported by 'iops'!");
+      }
+      iops_mode_c1();
+      goto finished;
+   }
    switch (tgs.mode) {
       case mode_compare:
       case mode_diff:
@@ -1041,16 +5637,7 @@ int main(int argc, char **argv) {
          break;
       default:
       {
-         long rc;
-         unsigned procs;
-         if (
-               (rc= sysconf(_SC_NPROCESSORS_ONLN)) == -1
-            || (procs= (unsigned)rc , (long)procs != rc)
-         ) {
-            error_c1(
-               &m, "Could not determine number of available CPU processors!"
-            );
-         }
+         unsigned const procs= available_processors_c1();
          if (!threads || procs < threads) threads= procs;
       }
       tgs.work_segments= 64;
@@ -1062,17 +5649,117 @@ int main(int argc, char **argv) {
          tgs.work_segments= threads;
       }
    }
-   /* Most threads will generate PRNG data. Another one does I/O and
-    * switches working buffers when the next buffer is ready. The main
-    * program thread only waits for termination of the other threads. */
+   /* Most threads will generate PRNG data. Another one does I/O. It
+    * writes segments as soon as they are ready, or switches working
+    * buffers when reading the next buffer. The main program thread only
+    * waits for termination of the other threads. */
    ++threads; /* Compensate workers for lazy main program. */
+   tgs.max_busy_workers= tgs.threads= threads;
+   if (tgs.order.kind != order_sequential) {
+      if (tgs.mode != mode_write && tgs.mode != mode_verify) {
+         error_c1(&m, "-o is only supported by 'write' and 'verify'!");
+      }
+      if (tgs.writeback.limit || tgs.discard.pre || tgs.discard.post) {
+         error_c1(&m, "-w, -d and -D are not supported with -o!");
+      }
+      if (tgs.tput.log || tgs.tput.min_rate || tgs.progress.interval_ns) {
+         error_c1(&m, "-l, -m and -P are not supported with -o!");
+      }
+      if (
+            tgs.stats.enabled || tgs.perf.enabled || tgs.mapped.enabled
+         || tgs.nt_stores || tgs.parallel.enabled
+      ) {
+         error_c1(&m, "-x, -H, -M, -n and -I are not supported with -o!");
+      }
+      if (!tgs.order.chunk) tgs.order.chunk= tgs.blksz;
+      ordered_mode_c1(threads - 1);
+      goto finished;
+   }
+   if (tgs.mapped.enabled) {
+      if (tgs.mode != mode_write && tgs.mode != mode_verify) {
+         error_c1(&m, "-M is only supported by 'write' and 'verify'!");
+      }
+      if (
+            tgs.writeback.limit || tgs.discard.pre || tgs.discard.post
+         || tgs.throttle.rate || tgs.tput.log || tgs.tput.min_rate
+         || tgs.progress.interval_ns || tgs.salvage.map || tgs.stats.enabled
+         || tgs.perf.enabled || tgs.nt_stores
+      ) {
+         error_c1(
+               &m
+            ,  "-w, -d, -D, -r, -l, -m, -P, -E, -x, -H and -n are not"
+               " supported with -M!"
+         );
+      }
+      mapped_mode_c1(threads - 1);
+      goto finished;
+   }
+   if (tgs.parallel.enabled) {
+      if (tgs.mode != mode_write && tgs.mode != mode_verify) {
+         error_c1(&m, "-I is only supported by 'write' and 'verify'!");
+      }
+      if (
+            tgs.writeback.limit || tgs.discard.pre || tgs.discard.post
+         || tgs.tput.log || tgs.tput.min_rate || tgs.progress.interval_ns
+         || tgs.salvage.map || tgs.stats.enabled || tgs.perf.enabled
+         || tgs.nt_stores
+      ) {
+         error_c1(
+               &m
+            ,  "-w, -d, -D, -l, -m, -P, -E, -x, -H and -n are not supported"
+               " with -I!"
+         );
+      }
+      parallel_mode_c1(threads - 1);
+      goto finished;
+   }
+   if (tgs.mode == mode_mixed) {
+      if (
+            tgs.discard.post || tgs.tput.log || tgs.tput.min_rate
+         || tgs.progress.interval_ns
+      ) {
+         error_c1(&m, "-D, -l, -m and -P are not supported by 'mixed'!");
+      }
+      mixed_mode_c1(threads - 1);
+      goto finished;
+   }
+   if (tgs.length) {
+      /* The buffer engines below just run until the end of the data. */
+      error_c1(
+            &m
+         ,  "-L is only supported by 'iops' and 'mixed' and with -o, -i, -M"
+            " or -I!"
+      );
+   }
+   tgs.adaptive= adaptive && tgs.mode == mode_write && threads > 2;
    tgs.work_segment_sz=
       CEIL_DIV(APPROXIMATE_BUFFER_SIZE, tgs.work_segments)
    ;
    tgs.work_segment_sz=
       CEIL_DIV(tgs.work_segment_sz, tgs.blksz) * tgs.blksz
    ;
+   if (tgs.digest.block || tgs.stats.enabled) {
+      /* Work segments must consist of whole blocks to be hashed, or of
+       * whole regions for the error density. */
+      size_t const unit= tgs.digest.block ? tgs.digest.block : STATS_REGION;
+      size_t a= unit, b= tgs.blksz, lcm;
+      while (b) {
+         size_t t= a % b;
+         a= b; b= t;
+      }
+      lcm= unit / a * tgs.blksz;
+      tgs.work_segment_sz= CEIL_DIV(tgs.work_segment_sz, lcm) * lcm;
+   }
    tgs.shared_buffer_size= tgs.work_segment_sz * tgs.work_segments;
+   if (tgs.digest.block) {
+      unsigned i;
+      for (i= (unsigned)DIM(tgs.digest.hashes); i--; ) {
+         tgs.digest.hashes[i]= calloc_c5(
+               tgs.shared_buffer_size / tgs.digest.block
+            ,  sizeof *tgs.digest.hashes[i]
+         );
+      }
+   }
    fprintf_c1(
          stderr
       ,  "Starting %s offset: %" PRIdFAST64 " bytes\n"
@@ -1082,7 +5769,6 @@ int main(int argc, char **argv) {
          "number of worker segments: %zu\n"
          "size of buffer providing those worker segments: %zu bytes\n"
          "number of such buffers: %u\n"
-         "\n%s PRNG data %s...\n"
       ,  tgs.mode != mode_write ? "input" : "output"
       ,  tgs.pos
       ,  (unsigned)tgs.blksz
@@ -1091,11 +5777,46 @@ int main(int argc, char **argv) {
       ,  tgs.work_segments
       ,  tgs.shared_buffer_size
       ,  (unsigned)DIM(tgs.shared_buffers)
-      ,  tgs.mode != mode_write ? "reading" : "writing"
-      ,  tgs.mode != mode_write
-         ? "from standard input"
-         : "to standard output"
    );
+   if (tgs.perf.enabled) {
+      /* Find out what we are permitted to count before the threads try. */
+      int fd[PERF_COUNTERS];
+      if (
+            !open_perf_counters(fd, 0)
+         || (tgs.perf.exclude_kernel= 1, !open_perf_counters(fd, 1))
+      ) {
+         unsigned i;
+         for (i= PERF_COUNTERS; i--; ) (void)close(fd[i]);
+      } else {
+         tgs.perf.enabled= 0;
+         fprintf_c1(
+            stderr, "Warning: No hardware performance counters available!\n"
+         );
+      }
+   }
+   if (tgs.compressible) {
+      fprintf_c1(
+            stderr
+         ,  "compressible bytes in every %u byte unit: %zu\n"
+         ,  (unsigned)COMPRESSIBLE_UNIT, tgs.compressible
+      );
+   }
+   if (tgs.throttle.rate) {
+      init_throttle_c1(tgs.blksz, tgs.shared_buffer_size);
+      fprintf_c1(
+            stderr
+         ,  "maximum I/O rate: %" PRIuFAST64 " bytes per second\n"
+            "size of paced I/O chunks: %zu bytes\n"
+         ,  tgs.throttle.rate, tgs.throttle.chunk
+      );
+      if (tgs.throttle.from_hour != tgs.throttle.to_hour) {
+         fprintf_c1(
+               stderr
+            ,  "I/O rate limited from %02u:00 to %02u:00 local time\n"
+            ,  tgs.throttle.from_hour, tgs.throttle.to_hour
+         );
+      }
+   }
    {
       static struct minimal_resource r;
       r.saved= m.rlist; r.dtor= &shared_buffers_dtor; m.rlist= &r.dtor;
@@ -1103,6 +5824,10 @@ int main(int argc, char **argv) {
    {
       unsigned i;
       for (i= (unsigned)DIM(tgs.shared_buffers); i--; ) {
+         /* Comparing byte by byte needs only a single buffer. */
+         if (i && (tgs.mode == mode_compare || tgs.mode == mode_diff)) {
+            continue;
+         }
          if (
             (
                tgs.shared_buffers[i]= mmap(
@@ -1118,17 +5843,41 @@ int main(int argc, char **argv) {
    tgs.shared_buffer_stop=
       (tgs.shared_buffer= tgs.shared_buffers[0]) + tgs.shared_buffer_size
    ;
-   {
-      static struct report_times_static_resource r;
-      if (clock_gettime(CLOCK_MONOTONIC, &r.started) < 0) goto unlikely_error;
-      r.saved= m.rlist; r.dtor= &report_times_dtor; m.rlist= &r.dtor;
+   if (tgs.salvage.map && tgs.mode == mode_compare) {
+      tgs.salvage.mask= calloc_c5(tgs.shared_buffer_size, 1);
+   }
+   if (tgs.mode == mode_write) {
+      tgs.pipeline.ready= calloc_c5(
+         tgs.work_segments * DIM(tgs.shared_buffers), 1
+      );
+   }
+   if (tgs.discard.pre) discard_pass_c1(tgs.discard.pre - 1);
+   if (tgs.discard.post) {
+      static struct minimal_resource r;
+      r.saved= m.rlist; r.dtor= &discard_post_pass_dtor; m.rlist= &r.dtor;
    }
+   fprintf_c1(
+         stderr
+      ,  "\n%s %sdata %s...\n"
+      ,  tgs.mode != mode_write ? "reading" : "writing"
+      ,  tgs.digest.block ? "" : "PRNG "
+      ,  tgs.mode != mode_write
+         ? "from standard input"
+         : "to standard output"
+   );
+   report_times_c5();
+   tgs.progress.last_ns= tgs.switch_ns= monotonic_ns();
    switch (tgs.mode) {
       case mode_verify:
-         /* In verify mode, we start with a "finished" buffer, forcing the
-          * next buffer to be read as the first worker thread action. */
+      case mode_digest:
+      case mode_verify_digest:
+         /* In the read modes, we start with a "finished" buffer, forcing
+          * the next buffer to be read as the first worker thread
+          * action. */
          if (tgs.mode != mode_write) {
             tgs.shared_buffer= (void *)tgs.shared_buffer_stop;
+            tgs.input.base= tgs.shared_buffers[0];
+            tgs.input.pos= tgs.pos;
          }
          /* Fall through. */
       default: break; /* To avoid switch-case coverage warnings. */
@@ -1139,6 +5888,7 @@ int main(int argc, char **argv) {
       slow_comparison();
       goto finished;
    }
+   threads_marker= m.rlist;
    tid= calloc_c5(threads, sizeof *tid);
    tvalid= calloc_c5(threads, sizeof *tvalid);
    {
@@ -1161,6 +5911,12 @@ int main(int argc, char **argv) {
          tvalid[i]= 1;
       }
    }
+   if (tgs.mode != mode_write) {
+      /* Wait for the threads to terminate before reporting the result. */
+      release_to_c1(&m, threads_marker);
+      if (tgs.num_errors) error_c1(&m, "Differences have been found!");
+      if (tgs.holes.extents) error_c1(&m, "Holes have been found!");
+   }
    finished:
    if (fflush(0)) error_c1(&m, msg_write_error);
    cleanup: